@@ -3,9 +3,18 @@
 #include <fstream>
 #include <string>
 #include <iostream>
+#include <map>
+#include <unordered_map>
 
 #include "Utils.h"
 #include "LexicalAnalyzer.h"
+#include "Optimizer.h"
+#include "Linker.h"
+
+//ֻĶԪӦOPR
+//˷*/modandshlshrӷ+-orxor
+const std::unordered_map<std::string, int32_t> MultiplicativeOperators = { {"mod",Mod},{"and",And},{"shl",Shl},{"shr",Shr} };
+const std::unordered_map<std::string, int32_t> AdditiveOperators = { {"or",Or},{"xor",Xor} };
 
 
 std::string SScopedIdentifier::ToString() const {
@@ -25,6 +34,21 @@ CCodeGenerator::CCodeGenerator(const std::vector<STerminator>& terminatorSequenc
 {
 }
 
+void CCodeGenerator::SetModuleSearchPath(const std::vector<std::filesystem::path>& searchPath)
+{
+	ModuleSearchPath = searchPath;
+}
+
+void CCodeGenerator::SetModule(const std::string& moduleName, std::shared_ptr<const SObjectFile> object)
+{
+	PreloadedModules[moduleName] = std::move(object);
+}
+
+void CCodeGenerator::SetSourceFile(const std::string& sourceFile)
+{
+	SourceFile = sourceFile;
+}
+
 void CCodeGenerator::GenerateCode()
 {
 	Program();
@@ -32,17 +56,95 @@ void CCodeGenerator::GenerateCode()
 		Error("Redundant characters after the period '.' on line " + std::to_string(TerminatorSequence[CurrentIndex].Line));
 	}
 
-	//еӳָкϲInstructions
-	for (auto& procedure : Procedures) {
-		procedure->Address = Instructions.size();
-		Instructions.insert(Instructions.end(), procedure->Instructions.begin(), procedure->Instructions.end());
+	COptimizer optimizer{ Procedures,CallInstructions };
+	optimizer.ReduceStrength();
+	optimizer.EliminateCommonSubexpressions();
+	optimizer.HoistLoopInvariants();
+	optimizer.ReserveTemporaries();
+	optimizer.EliminateStaticLinks();
+	optimizer.BuildDataSegment(Data);
+	BuildObject();
+
+	//еӳָкϲInstructionsвҪ뵼ģ
+	//ģֻΪָӣеĵַӵ֮ı
+	CLinker linker{ Object };
+	for (auto& module : ImportedModules) {
+		linker.AddModule(module.Object);
+	}
+	linker.Link();
+	Instructions = linker.GetInstructions();
+	if (!bIsModule) {
+		for (uint32_t i{}; i < Procedures.size(); i++) {
+			Procedures[i]->Address = linker.GetProcedureAddress(i);
+		}
+		Symbols = linker.GetSymbols();
+	}
+}
+
+//ӳӳʼ"p1::p2"Ϊ"main"
+static std::string GetQualifiedName(const SProcedure& procedure)
+{
+	std::string name = procedure.Name;
+	for (const SProcedure* parent = procedure.Parent; parent && parent->Parent; parent = parent->Parent) {
+		name = parent->Name + "::" + name;
+	}
+	return name;
+}
+
+void CCodeGenerator::BuildObject()
+{
+	//ģֻڷģݣĿļ
+	uint32_t firstProcedure = bIsModule ? 1 : 0;
+	std::map<const SProcedure*, uint32_t> procedureIndices;
+	for (uint32_t i = firstProcedure; i < Procedures.size(); i++) {
+		procedureIndices[Procedures[i].get()] = i - firstProcedure;
+	}
+
+	Object = {};
+	Object.ModuleName = ModuleName;
+	Object.SourceFile = SourceFile;
+	Object.Data = Data;
+	for (uint32_t i = firstProcedure; i < Procedures.size(); i++) {
+		SProcedure& procedure = *Procedures[i];
+		Object.Procedures.push_back({ GetQualifiedName(procedure),procedure.Level,procedure.bNeedsStaticLink,procedure.Instructions,procedure.GlobalReferences,procedure.Lines });
 	}
-	//
 	for (auto& callInstruction : CallInstructions) {
-		uint32_t callInstructionAddress = callInstruction.CallInstructionOffset + callInstruction.Procedure->Address;
-		uint32_t calledProcedureAddress = callInstruction.CalledProcedure->Address;
-		Instructions[callInstructionAddress] = { CAL,callInstruction.LevelDifference,(int32_t)calledProcedureAddress };
+		SObjectCall call{ procedureIndices.at(callInstruction.Procedure),callInstruction.CallInstructionOffset,callInstruction.LevelDifference };
+		auto it = procedureIndices.find(callInstruction.CalledProcedure);
+		if (it != procedureIndices.end()) {
+			call.CalledProcedure = it->second;
+		}
+		else {
+			//õģеӳʱģӳ
+			call.CalledProcedure = SObjectCall::External;
+			for (auto& module : ImportedModules) {
+				for (auto& procedure : module.Procedures) {
+					if (procedure.get() == callInstruction.CalledProcedure) {
+						call.Module = module.Name;
+						call.Name = procedure->Name;
+					}
+				}
+			}
+		}
+		Object.Calls.push_back(std::move(call));
+	}
+	if (bIsModule) {
+		for (auto& variable : Procedures[0]->Variables) {
+			Object.Variables.push_back({ variable.Name,variable.Type,variable.Offset,variable.bIsConst });
+		}
 	}
+	for (auto& module : ImportedModules) {
+		Object.Imports.push_back({ module.Name,module.DataAddress });
+	}
+}
+
+void CCodeGenerator::MarkLine(SProcedure& procedure)
+{
+	//ͬһλֻһ֮ǰûָһͬһʱҪµһ
+	std::vector<SLineEntry>& lines = procedure.Lines;
+	uint32_t offset = procedure.Instructions.size();
+	if (!lines.empty() && lines.back().Offset == offset) lines.pop_back();
+	if (lines.empty() || lines.back().Line != CurrentLine) lines.push_back({ offset,CurrentLine });
 }
 
 void CCodeGenerator::PrintInstructions()
@@ -103,6 +205,45 @@ void CCodeGenerator::PrintInstructions()
 		case 17:
 			std::cout << "POP";
 			break;
+		case 18:
+			std::cout << "CAL_v2";
+			break;
+		case 19:
+			std::cout << "LDG";
+			break;
+		case 20:
+			std::cout << "STO_v2";
+			break;
+		case 21:
+			std::cout << "FOR";
+			break;
+		case 22:
+			std::cout << "JTB";
+			break;
+		case 23:
+			std::cout << "VEC";
+			break;
+		case 24:
+			std::cout << "FAL";
+			break;
+		case 25:
+			std::cout << "HLT";
+			break;
+		case 26:
+			std::cout << "NEW";
+			break;
+		case 27:
+			std::cout << "FRE";
+			break;
+		case 28:
+			std::cout << "RED";
+			break;
+		case 29:
+			std::cout << "RDA";
+			break;
+		case 30:
+			std::cout << "SNP";
+			break;
 		default:
 			break;
 		}
@@ -116,10 +257,60 @@ void CCodeGenerator::Output(const std::string& FileName)
 	if (!fout.is_open()) {
 		Error("Cannot open file " + FileName);
 	}
+	Output(fout);
+}
 
+void CCodeGenerator::Output(std::ostream& out)
+{
+	if (bIsModule) {
+		Object.Write(out);
+		return;
+	}
+	SExecutableHeader header{ ExecutableMagic,sizeof(word_t),Instructions.size(),DataAddress,Data.size() };
+	out.write((char*)&header, sizeof(header));
 	for (auto& instruction : Instructions) {
-		fout.write((char*)&instruction, sizeof(instruction));
+		out.write((char*)&instruction, sizeof(instruction));
+	}
+	out.write((char*)Data.data(), Data.size() * sizeof(word_t));
+}
+
+void CCodeGenerator::OutputSymbols(std::ostream& out)
+{
+	out << "pl0-symbols " << WordBits << ' ' << Symbols.NumInstructions << '\n';
+	for (auto& file : Symbols.Files) {
+		out << "file " << file << '\n';
+	}
+	for (auto& procedure : Symbols.Procedures) {
+		out << "procedure " << procedure.Address << ' ' << procedure.Name << '\n';
 	}
+	for (auto& line : Symbols.Lines) {
+		out << "line " << line.Address << ' ' << line.File << ' ' << line.Line << '\n';
+	}
+}
+
+const std::vector<Instruction>& CCodeGenerator::GetInstructions() const
+{
+	return Instructions;
+}
+
+const std::vector<word_t>& CCodeGenerator::GetData() const
+{
+	return Data;
+}
+
+bool CCodeGenerator::IsModule() const
+{
+	return bIsModule;
+}
+
+const SObjectFile& CCodeGenerator::GetObject() const
+{
+	return Object;
+}
+
+const SSymbolTable& CCodeGenerator::GetSymbols() const
+{
+	return Symbols;
 }
 
 std::string CCodeGenerator::GetNextTerminatorType() {
@@ -246,6 +437,19 @@ void CCodeGenerator::FindVariable(SProcedure& procedure, const SScopedIdentifier
 			procedurePtr = procedurePtr->Parent;
 		}
 		if (!procedurePtr) {
+			//ģıģ::
+			for (auto& module : ImportedModules) {
+				if (module.Name != firstIdentifier || scopedIdentifier.Identifiers.size() != 2) continue;
+				const SObjectVariable* variable = module.Object->FindVariable(scopedIdentifier.Identifiers[1]);
+				if (!variable) {
+					Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": cannot find variable '" + scopedIdentifier.ToString() + "'");
+				}
+				type = variable->Type;
+				levelDiff = -procedure.Level;
+				offset = module.DataAddress + variable->Offset - DataAddress;
+				isConst = variable->bIsConst;
+				return;
+			}
 			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": identifier '" + firstIdentifier + "' has not been declared");
 		}
 		//ȻѰʣ
@@ -298,6 +502,17 @@ void CCodeGenerator::FindSubProcedure(SProcedure& procedure, uint32_t identTermi
 				break;
 			}
 		}
+		//forallѭ廹Եӳӳѭͬ
+		if (!found && procedure.bIsForallBody) {
+			for (auto procedurePtr : procedure.Parent->SubProcedures) {
+				if (procedurePtr->Name == procedureName) {
+					found = true;
+					calledProcedure = procedurePtr;
+					levelDiff = 0;
+					break;
+				}
+			}
+		}
 		if (!found) {
 			SProcedure* currentProcedure = procedure.Parent;
 			levelDiff = -1;
@@ -313,9 +528,35 @@ void CCodeGenerator::FindSubProcedure(SProcedure& procedure, uint32_t identTermi
 		}
 	}
 
+	if (!found) {
+		found = FindImportedProcedure(procedure, "", procedureName, calledProcedure, levelDiff);
+	}
 	if (!found) {
 		Error("Line " + std::to_string(TerminatorSequence[identTerminatorIndex].Line) + ": procedure '" + procedureName + "' has not been declared");
 	}
+	//ģֻڷģ
+	if (bIsModule && calledProcedure == Procedures[0].get()) {
+		Error("Line " + std::to_string(TerminatorSequence[identTerminatorIndex].Line) + ": the main program of a module cannot be called");
+	}
+}
+
+bool CCodeGenerator::FindImportedProcedure(SProcedure& procedure, const std::string& moduleName, const std::string& procedureName, SProcedure*& calledProcedure, int16_t& levelDiff)
+{
+	bool found{};
+	for (auto& module : ImportedModules) {
+		if (!moduleName.empty() && module.Name != moduleName) continue;
+		for (auto& procedurePtr : module.Procedures) {
+			if (procedurePtr->Name != procedureName) continue;
+			if (found) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": procedure '" + procedureName + "' is exported by more than one module, use module::" + procedureName);
+			}
+			found = true;
+			calledProcedure = procedurePtr.get();
+		}
+	}
+	//õӳĸ
+	levelDiff = 1 - procedure.Level;
+	return found;
 }
 
 void CCodeGenerator::TurnRightValueToLeftValue(std::vector<Instruction>& instructions, const SValue& value)
@@ -328,7 +569,7 @@ void CCodeGenerator::TurnRightValueToLeftValue(std::vector<Instruction>& instruc
 		//޸һָʹִָнջǸֵĵַǸֵֵ
 		if (instructions.back().F == LOD) {
 			int16_t levelDiff = instructions.back().L;
-			int32_t offset = instructions.back().a;
+			word_t offset = instructions.back().a;
 			instructions.pop_back();
 			instructions.push_back({ LOA,levelDiff,offset });
 		}
@@ -349,12 +590,113 @@ void CCodeGenerator::Program()
 {
 	//
 	Procedures.push_back(std::make_shared<SProcedure>(nullptr, 0, "main"));	//ParentΪnullptrLevelΪ0
-	Procedure(*Procedures[0]);
+	GetNextTerminatorType();
+	CurrentLine = TerminatorSequence[CurrentIndex].Line;
+	if (GetNextTerminatorType() == "module") {
+		ModuleDeclare();
+	}
+	else {
+		while (GetNextTerminatorType() == "import") {
+			ImportDeclare(*Procedures[0]);
+		}
+		Procedure(*Procedures[0]);
+	}
 
 	Match(".");
 }
 
-void CCodeGenerator::Match(const std::string& type, int32_t* numverValue, std::string* identifierName)
+void CCodeGenerator::ModuleDeclare()
+{
+	Match("module");
+	Match("ident", nullptr, &ModuleName);
+	Match(";");
+	bIsModule = true;
+
+	//ģĳջ֡УĳΪռ䣻ӳĲΪ1
+	SProcedure& main = *Procedures[0];
+	while (true) {
+		std::string nextTerminatorType = GetNextTerminatorType();
+		if (nextTerminatorType == "const") {
+			ConstDeclare(main);
+		}
+		else if (nextTerminatorType == "var") {
+			VarDeclare(main);
+		}
+		else if (nextTerminatorType == "procedure") {
+			ProcedureDeclare(main);
+		}
+		else if (nextTerminatorType == "import") {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex].Line) + ": a module cannot import other modules");
+		}
+		else break;
+	}
+	main.StatementOffset = main.Instructions.size();
+	main.Instructions.push_back({ RET,0,0 });
+}
+
+void CCodeGenerator::ImportDeclare(SProcedure& main)
+{
+	Match("import");
+
+	while (true) {
+		std::string moduleName;
+		Match("ident", nullptr, &moduleName);
+		std::string line = std::to_string(TerminatorSequence[CurrentIndex - 1].Line);
+		for (auto& module : ImportedModules) {
+			if (module.Name == moduleName) {
+				Error("Line " + line + ": module '" + moduleName + "' has already been imported");
+			}
+		}
+
+		std::shared_ptr<const SObjectFile> object;
+		auto it = PreloadedModules.find(moduleName);
+		if (it != PreloadedModules.end()) {
+			object = it->second;
+		}
+		else {
+			std::string content, errorMessage;
+			object = LoadModule(moduleName, ModuleSearchPath, content, errorMessage);
+			if (!object) {
+				Error("Line " + line + ": cannot import module '" + moduleName + "': " + errorMessage);
+			}
+		}
+
+		//ջ֡аģĳֵΪݷռ䣬0һINT
+		SImportedModule module{ moduleName,object,main.StackOffset };
+		for (size_t i{}; i < object->Data.size();) {
+			size_t end = i;
+			while (end < object->Data.size() && object->Data[end] == 0) end++;
+			if (end > i) {
+				main.Instructions.push_back({ INT,0,(word_t)(end - i) });
+				i = end;
+			}
+			else {
+				main.Instructions.push_back({ LIT,0,object->Data[i] });
+				i++;
+			}
+		}
+		main.StackOffset += object->Data.size();
+
+		//ӳûָֻڲҺŻǷҪ̬ɱģʱķ
+		for (auto& exported : object->Procedures) {
+			if (exported.Level != 1) continue;
+			auto procedure = std::make_shared<SProcedure>(&main, (int16_t)1, exported.Name);
+			procedure->bNeedsStaticLink = exported.bNeedsStaticLink;
+			module.Procedures.push_back(procedure);
+		}
+		ImportedModules.push_back(std::move(module));
+
+		if (GetNextTerminatorType() == ",") {
+			Match(",");
+		}
+		else {
+			Match(";");
+			break;
+		}
+	}
+}
+
+void CCodeGenerator::Match(const std::string& type, word_t* numverValue, std::string* identifierName)
 {
 	if (!IsPossibleTerminatorType(type)) {
 		Error("Compiler internal error: unknown terminator type '" + type + "'");
@@ -400,6 +742,8 @@ void CCodeGenerator::ScopedIdentifier(SScopedIdentifier& scopedIdentifier)
 
 void CCodeGenerator::Procedure(SProcedure& procedure)
 {
+	//ֵָRETӳͷڵ
+	MarkLine(procedure);
 	while (true) {
 		std::string nextTerminatorType = GetNextTerminatorType();
 
@@ -413,6 +757,7 @@ void CCodeGenerator::Procedure(SProcedure& procedure)
 			ProcedureDeclare(procedure);
 		}
 		else {
+			procedure.StatementOffset = procedure.Instructions.size();
 			Statement(procedure);
 			break;
 		}
@@ -425,15 +770,60 @@ void CCodeGenerator::ConstDeclare(SProcedure& procedure)
 	Match("const");
 
 	std::string identifierName;
-	int32_t numberValue;
+	word_t numberValue;
 	while (true) {
 		Match("ident", nullptr, &identifierName);
-		Match("=");
-		Match("number", &numberValue);
-		AddVariable(procedure, CurrentIndex - 3, SType{ EType::Integer }, true);
+		uint32_t indexOfIdentTerminator = CurrentIndex - 1;
+
+		//飺const t[2][2] = (1, 2, 3, 4)չ˳Ԫصֵ
+		if (GetNextTerminatorType() == "[") {
+			std::vector<uint32_t> dimensions;
+			while (GetNextTerminatorType() == "[") {
+				Match("[");
+				Match("number", &numberValue);
+				if (numberValue <= 0) {
+					Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": dimension must be positive");
+				}
+				if ((uword_t)numberValue > UINT32_MAX) {
+					Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": dimension too large");
+				}
+				dimensions.push_back(numberValue);
+				Match("]");
+			}
+			SType type = BuildNDimArrayType(dimensions, 0, SType{ EType::Integer });
+			Match("=");
+			Match("(");
+			std::vector<word_t> values;
+			while (true) {
+				bool isNegative{};
+				if (GetNextTerminatorType() == "-") {
+					Match("-");
+					isNegative = true;
+				}
+				Match("number", &numberValue);
+				values.push_back(isNegative ? -numberValue : numberValue);
+				if (GetNextTerminatorType() != ",") break;
+				Match(",");
+			}
+			Match(")");
+			if (values.size() != GetSize(type)) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": const array needs exactly " + std::to_string(GetSize(type)) + " values");
+			}
+			AddVariable(procedure, indexOfIdentTerminator, type, true);
+
+			//ԪصֵδջУĳᱻתΪݶ
+			for (word_t value : values) {
+				procedure.Instructions.push_back({ LIT,0,value });
+			}
+		}
+		else {
+			Match("=");
+			Match("number", &numberValue);
+			AddVariable(procedure, indexOfIdentTerminator, SType{ EType::Integer }, true);
 
-		//ֵջ
-		procedure.Instructions.push_back({ LIT,0,numberValue });
+			//ֵջ
+			procedure.Instructions.push_back({ LIT,0,numberValue });
+		}
 
 		if (GetNextTerminatorType() == ";") {
 			Match(";");
@@ -483,11 +873,14 @@ void CCodeGenerator::VarDefine(SProcedure& procedure)
 	while (true) {
 		if (GetNextTerminatorType() == "[") {
 			Match("[");
-			int32_t numberValue;
+			word_t numberValue;
 			Match("number", &numberValue);
 			if (numberValue <= 0) {
 				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": dimension must be positive");
 			}
+			if ((uword_t)numberValue > UINT32_MAX) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": dimension too large");
+			}
 			dimensions.push_back(numberValue);
 			Match("]");
 		}
@@ -502,7 +895,7 @@ void CCodeGenerator::VarDefine(SProcedure& procedure)
 	//¼ñ
 	AddVariable(procedure, indexOfIdentTerminator, type);
 	//ջΪñռ
-	procedure.Instructions.push_back({ INT,0,(int32_t)GetSize(type) });
+	procedure.Instructions.push_back({ INT,0,(word_t)GetSize(type) });
 }
 
 void CCodeGenerator::ProcedureDeclare(SProcedure& procedure)
@@ -512,13 +905,20 @@ void CCodeGenerator::ProcedureDeclare(SProcedure& procedure)
 	Match("ident", nullptr, &procedureName);
 	Match(";");
 	AddSubProcedure(procedure, CurrentIndex - 2);
+	uint32_t outerLine = CurrentLine;
+	CurrentLine = TerminatorSequence[CurrentIndex - 2].Line;
 	Procedure(*Procedures.back());
+	CurrentLine = outerLine;
 	Match(";");
 }
 
 void CCodeGenerator::Statement(SProcedure& procedure)
 {
 	std::string nextTerminatorType = GetNextTerminatorType();
+	//ָ俪ͷڵУǶ׵ָ֮ѭĩβת
+	uint32_t outerLine = CurrentLine;
+	CurrentLine = TerminatorSequence[CurrentIndex].Line;
+	MarkLine(procedure);
 
 	if (nextTerminatorType == "ident" || nextTerminatorType == "number" || nextTerminatorType == "(" || nextTerminatorType == "*" || nextTerminatorType == "&") {
 		AssignStatement(procedure);
@@ -535,12 +935,32 @@ void CCodeGenerator::Statement(SProcedure& procedure)
 	else if (nextTerminatorType == "while") {
 		WhileStatement(procedure);
 	}
+	else if (nextTerminatorType == "for") {
+		ForStatement(procedure);
+	}
+	else if (nextTerminatorType == "case") {
+		CaseStatement(procedure);
+	}
+	else if (nextTerminatorType == "forall") {
+		ForallStatement(procedure);
+	}
+	else if (nextTerminatorType == "vcopy" || nextTerminatorType == "vfill" || nextTerminatorType == "vadd" || nextTerminatorType == "vsub" || nextTerminatorType == "vmul") {
+		VectorStatement(procedure);
+	}
 	else if (nextTerminatorType == "print") {
 		PrintStatement(procedure);
 	}
+	else if (nextTerminatorType == "free") {
+		FreeStatement(procedure);
+	}
+	else if (nextTerminatorType == "snapshot") {
+		SnapshotStatement(procedure);
+	}
 	else {
 		Error("Expected a statement on line " + std::to_string(TerminatorSequence[CurrentIndex].Line));
 	}
+	CurrentLine = outerLine;
+	MarkLine(procedure);
 }
 
 void CCodeGenerator::StatementSequence(SProcedure& procedure)
@@ -575,7 +995,8 @@ void CCodeGenerator::AssignStatement(SProcedure& procedure)
 		nextValue = Expression(procedure, *instructions.back());
 		values.push_back(nextValue);
 
-		if (value.Type != nextValue.Type) {
+		bool isUntypedPointerAssignment = nextValue.bIsUntypedPointer && value.Type.Type == EType::Pointer;
+		if (value.Type != nextValue.Type && !isUntypedPointerAssignment) {
 			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": cannot assign value to a different type");
 		}
 
@@ -619,10 +1040,21 @@ void CCodeGenerator::CallStatement(SProcedure& procedure)
 	Match("call");
 	Match("ident");
 
-	//Ҫõӳ
+	//Ҫõӳģ::ӳָģ鵼ӳ
 	SProcedure* calledProcedure;
 	int16_t levelDiff;
-	FindSubProcedure(procedure, CurrentIndex - 1, calledProcedure, levelDiff);
+	if (GetNextTerminatorType() == "::") {
+		std::string moduleName = TerminatorSequence[CurrentIndex - 1].IdentifierName;
+		std::string procedureName;
+		Match("::");
+		Match("ident", nullptr, &procedureName);
+		if (!FindImportedProcedure(procedure, moduleName, procedureName, calledProcedure, levelDiff)) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": procedure '" + moduleName + "::" + procedureName + "' has not been imported");
+		}
+	}
+	else {
+		FindSubProcedure(procedure, CurrentIndex - 1, calledProcedure, levelDiff);
+	}
 
 	//ָӿյCALָռλ
 	procedure.Instructions.push_back({ CAL,levelDiff,0 });
@@ -661,11 +1093,310 @@ void CCodeGenerator::WhileStatement(SProcedure& procedure)
 	procedure.Instructions.push_back({ JPC,0,0 });
 	uint32_t jpcInstructionOffset = procedure.Instructions.size() - 1;
 	Statement(procedure);
-	procedure.Instructions.push_back({ JMP,0,(int32_t)conditionOffset - (int32_t)procedure.Instructions.size() });	//תж
+	procedure.Instructions.push_back({ JMP,0,(word_t)conditionOffset - (word_t)procedure.Instructions.size() });	//תж
 	//
 	procedure.Instructions[jpcInstructionOffset].a = procedure.Instructions.size() - jpcInstructionOffset;
 }
 
+void CCodeGenerator::ForStatement(SProcedure& procedure)
+{
+	Match("for");
+
+	//ƥѭ
+	SScopedIdentifier scopedIdentifier;
+	ScopedIdentifier(scopedIdentifier);
+	SType type;
+	int16_t levelDiff;
+	uint32_t offset;
+	bool isConst;
+	FindVariable(procedure, scopedIdentifier, type, levelDiff, offset, isConst);
+	if (type.Type != EType::Integer || isConst) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": for loop variable must be an integer variable");
+	}
+	if (levelDiff != 0 || offset > INT16_MAX) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": for loop variable must be a local variable of the current procedure");
+	}
+
+	Match(":=");
+	SValue initialValue = Expression(procedure, procedure.Instructions);
+	Match("to");
+	SValue limitValue = Expression(procedure, procedure.Instructions);
+	if (initialValue.Type.Type != EType::Integer || limitValue.Type.Type != EType::Integer) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": for loop bounds must be integer");
+	}
+
+	//ƥ䲽ĬΪ1
+	word_t step = 1;
+	if (GetNextTerminatorType() == "step") {
+		Match("step");
+		bool isNegative{};
+		if (GetNextTerminatorType() == "-") {
+			Match("-");
+			isNegative = true;
+		}
+		Match("number", &step);
+		if (isNegative) step = -step;
+		if (step == 0) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": for loop step cannot be 0");
+		}
+	}
+	Match("do");
+
+	/*
+	ֵֵڸѭֵ֮ǰ㣬벽һջУȻֱѭĩβFORָѳֵѭжǷѭ
+	ѭУֵͲһֱջУFORָѭʱ
+	*/
+	procedure.Instructions.push_back({ LIT,0,step });
+	procedure.Instructions.push_back({ JMP,0,0 });
+	uint32_t jmpInstructionOffset = procedure.Instructions.size() - 1;
+	Statement(procedure);
+	procedure.Instructions.push_back({ FOR,(int16_t)offset,(word_t)jmpInstructionOffset + 1 - (word_t)procedure.Instructions.size() });
+	//
+	procedure.Instructions[jmpInstructionOffset].a = procedure.Instructions.size() - 1 - jmpInstructionOffset;
+}
+
+void CCodeGenerator::ForallStatement(SProcedure& procedure)
+{
+	Match("forall");
+	Match("ident");
+	uint32_t indexOfIdentTerminator = CurrentIndex - 1;
+
+	//ֵֵڵǰӳм㣬ִFALָʱջ
+	Match(":=");
+	SValue initialValue = Expression(procedure, procedure.Instructions);
+	Match("to");
+	SValue limitValue = Expression(procedure, procedure.Instructions);
+	if (initialValue.Type.Type != EType::Integer || limitValue.Type.Type != EType::Integer) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": forall loop bounds must be integer");
+	}
+	Match("do");
+
+	/*
+	ѭǵǰӳһӳ򣬲SubProceduresУ˲ܱcall
+	Ϊÿεջ֡ѹDLRASLѭѭƫΪ3ҪINTָռ
+	*/
+	//дкţڷűͬһӳеĶforallѭ
+	std::string bodyName = "forall@" + std::to_string(TerminatorSequence[indexOfIdentTerminator].Line);
+	Procedures.push_back(std::make_shared<SProcedure>(&procedure, (int16_t)(procedure.Level + 1), bodyName));
+	SProcedure& body = *Procedures.back();
+	body.bIsForallBody = true;
+	MarkLine(body);
+	AddVariable(body, indexOfIdentTerminator, SType{ EType::Integer });
+	if (GetNextTerminatorType() == "var") {
+		VarDeclare(body);
+	}
+	body.StatementOffset = body.Instructions.size();
+	Statement(body);
+	body.Instructions.push_back({ RET,0,0 });
+
+	//εִУֱӸļ򵥱ֵһݾ
+	for (size_t i = 1; i < body.Instructions.size(); i++) {
+		const Instruction& instruction = body.Instructions[i];
+		bool isDirectStore = (instruction.F == STR || instruction.F == STR_v2) && body.Instructions[i - 1].F == LOA && body.Instructions[i - 1].L < 0;
+		if (isDirectStore || (instruction.F == STO && instruction.L < 0)) {
+			Error("Line " + std::to_string(TerminatorSequence[indexOfIdentTerminator].Line) + ": forall loop body cannot assign to a variable of an outer procedure");
+		}
+	}
+
+	//ָӿյFALָռλȴѭĵַ
+	procedure.Instructions.push_back({ FAL,0,0 });
+	CallInstructions.push_back({ &procedure,(uint32_t)(procedure.Instructions.size() - 1),&body,1 });
+}
+
+/*
+Ϊcaseб[begin, end)еĲɶֲҵıȽѡʽֵƫΪselectorOffsetı
+labelsŴСУеתĿǷ֧ڷ֧뿪ͷλãɵתָĿ¼targetsУȴ
+*/
+static void GenerateCaseTree(const std::vector<std::pair<word_t, uint32_t>>& labels, size_t begin, size_t end, word_t selectorOffset, uint32_t defaultTarget,
+	std::vector<Instruction>& dispatch, std::vector<std::pair<uint32_t, uint32_t>>& targets)
+{
+	//ŽʱȽ
+	if (end - begin <= 3) {
+		for (size_t k = begin; k < end; k++) {
+			dispatch.push_back({ LOD,0,selectorOffset });
+			dispatch.push_back({ LIT,0,labels[k].first });
+			dispatch.push_back({ OPR,0,NotEqual });
+			dispatch.push_back({ JPC,0,0 });		//ʱת֧
+			targets.push_back({ (uint32_t)dispatch.size() - 1,labels[k].second });
+		}
+		dispatch.push_back({ JMP,0,0 });
+		targets.push_back({ (uint32_t)dispatch.size() - 1,defaultTarget });
+		return;
+	}
+
+	size_t middle = (begin + end) / 2;
+	dispatch.push_back({ LOD,0,selectorOffset });
+	dispatch.push_back({ LIT,0,labels[middle].first });
+	dispatch.push_back({ OPR,0,LessThan });
+	dispatch.push_back({ JPC,0,0 });		//СмıʱתҰ벿
+	uint32_t jpcInstructionOffset = dispatch.size() - 1;
+	GenerateCaseTree(labels, begin, middle, selectorOffset, defaultTarget, dispatch, targets);
+	dispatch[jpcInstructionOffset].a = dispatch.size() - jpcInstructionOffset;
+	GenerateCaseTree(labels, middle, end, selectorOffset, defaultTarget, dispatch, targets);
+}
+
+void CCodeGenerator::CaseStatement(SProcedure& procedure)
+{
+	Match("case");
+	SValue selector = Expression(procedure, procedure.Instructions);
+	if (selector.Type.Type != EType::Integer) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": case selector must be integer");
+	}
+	Match("of");
+
+	//֧Ĵֱѡʽ֮ȫɡ֪еı֮ٽɴ뵽֮ǰ
+	uint32_t armsOffset = procedure.Instructions.size();
+	std::map<word_t, uint32_t> labels;		// -> ֧ڷ֧뿪ͷλ
+	std::vector<uint32_t> endJumps;			//֧ĩβתcase֮JMPָ
+	while (GetNextTerminatorType() != "else" && GetNextTerminatorType() != "end") {
+		uint32_t armStart = procedure.Instructions.size() - armsOffset;
+		while (true) {
+			bool isNegative{};
+			if (GetNextTerminatorType() == "-") {
+				Match("-");
+				isNegative = true;
+			}
+			word_t label;
+			Match("number", &label);
+			if (isNegative) label = -label;
+			if (!labels.insert({ label,armStart }).second) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": duplicate case label " + std::to_string(label));
+			}
+
+			if (GetNextTerminatorType() == ",") {
+				Match(",");
+			}
+			else {
+				break;
+			}
+		}
+		Match(":");
+		Statement(procedure);
+		Match(";");
+		procedure.Instructions.push_back({ JMP,0,0 });
+		endJumps.push_back(procedure.Instructions.size() - 1);
+	}
+	uint32_t defaultTarget;
+	if (GetNextTerminatorType() == "else") {
+		Match("else");
+		defaultTarget = procedure.Instructions.size() - armsOffset;
+		Statement(procedure);
+		Match(";");
+	}
+	else {
+		//һ֧֮caseĩβҪת
+		if (!endJumps.empty()) {
+			procedure.Instructions.pop_back();
+			endJumps.pop_back();
+		}
+		defaultTarget = procedure.Instructions.size() - armsOffset;
+	}
+	Match("end");
+
+	//ɷɴ
+	std::vector<Instruction> dispatch;
+	std::vector<std::pair<uint32_t, uint32_t>> targets;		//ɴеתָתĿ꣩
+	word_t low = labels.empty() ? 0 : labels.begin()->first;
+	uint64_t span = labels.empty() ? 0 : (uint64_t)labels.rbegin()->first - (uint64_t)low;	//С֮޷㲻
+	if (labels.empty()) {
+		dispatch.push_back({ POP,0,0 });
+	}
+	else if (labels.size() >= 4 && span < 3 * (uint64_t)labels.size()) {
+		//ųܣȥСıźΪ±תеĿλԽ±궼תelse֧
+		if (low != 0) {
+			dispatch.push_back({ LIT,0,low });
+			dispatch.push_back({ OPR,0,Sub });
+		}
+		dispatch.push_back({ JTB,0,(word_t)(span + 1) });
+		for (uint64_t k{}; k <= span; k++) {
+			auto it = labels.find((word_t)((uint64_t)low + k));
+			dispatch.push_back({ JMP,0,0 });
+			targets.push_back({ (uint32_t)dispatch.size() - 1,it == labels.end() ? defaultTarget : it->second });
+		}
+		dispatch.push_back({ JMP,0,0 });
+		targets.push_back({ (uint32_t)dispatch.size() - 1,defaultTarget });
+	}
+	else {
+		//ϡ裺Ƚѡʽֵ浽ʱУöֲҵıȽ
+		if (procedure.CaseSelectorOffset < 0) {
+			procedure.CaseSelectorOffset = procedure.StackOffset++;
+			procedure.NumTemporaries++;
+		}
+		dispatch.push_back({ STO,0,procedure.CaseSelectorOffset });
+		std::vector<std::pair<word_t, uint32_t>> sortedLabels(labels.begin(), labels.end());
+		GenerateCaseTree(sortedLabels, 0, sortedLabels.size(), procedure.CaseSelectorOffset, defaultTarget, dispatch, targets);
+	}
+
+	//ɴ룬ת֮CALָλúкűɴcaseڵ
+	for (auto& [instructionOffset, target] : targets) {
+		dispatch[instructionOffset].a = dispatch.size() + target - instructionOffset;
+	}
+	procedure.Instructions.insert(procedure.Instructions.begin() + armsOffset, dispatch.begin(), dispatch.end());
+	for (auto& callInstruction : CallInstructions) {
+		if (callInstruction.Procedure == &procedure && callInstruction.CallInstructionOffset >= armsOffset) {
+			callInstruction.CallInstructionOffset += dispatch.size();
+		}
+	}
+	for (auto& entry : procedure.Lines) {
+		if (entry.Offset >= armsOffset) entry.Offset += dispatch.size();
+	}
+	for (auto endJump : endJumps) {
+		endJump += dispatch.size();
+		procedure.Instructions[endJump].a = procedure.Instructions.size() - endJump;
+	}
+}
+
+void CCodeGenerator::ArrayOperand(SProcedure& procedure, std::vector<Instruction>& instructions, SType& arrayType, bool isDestination)
+{
+	SValue value = Expression(procedure, instructions);
+	if (value.Type.Type != EType::Pointer || value.ArraySize == 0) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": expected an array here");
+	}
+	if (isDestination && value.bIsConst) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": cannot write to a const array");
+	}
+	arrayType = SType{ EType::Array,value.Type.InnerType,value.ArraySize };
+}
+
+void CCodeGenerator::VectorStatement(SProcedure& procedure)
+{
+	std::string functionName = GetNextTerminatorType();
+	Match(functionName);
+	Match("(");
+
+	//ԪڲԪصͶͬ
+	std::vector<SType> arrayTypes(1);
+	ArrayOperand(procedure, procedure.Instructions, arrayTypes[0], true);
+	Match(",");
+	if (functionName == "vfill") {
+		if (Expression(procedure, procedure.Instructions).Type.Type != EType::Integer) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": vfill value must be integer");
+		}
+	}
+	else {
+		arrayTypes.emplace_back();
+		ArrayOperand(procedure, procedure.Instructions, arrayTypes.back());
+		if (functionName != "vcopy") {
+			Match(",");
+			arrayTypes.emplace_back();
+			ArrayOperand(procedure, procedure.Instructions, arrayTypes.back());
+		}
+	}
+	Match(")");
+
+	for (auto& arrayType : arrayTypes) {
+		if (GetSize(arrayType) != GetSize(arrayTypes[0]) || GetElementType(arrayType) != GetElementType(arrayTypes[0])) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": " + functionName + " requires arrays of the same size and element type");
+		}
+	}
+	if (functionName != "vcopy" && GetElementType(arrayTypes[0]).Type != EType::Integer) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": " + functionName + " requires integer arrays");
+	}
+
+	int16_t operation = functionName == "vcopy" ? VecCopy : functionName == "vfill" ? VecFill : functionName == "vadd" ? VecAdd : functionName == "vsub" ? VecSub : VecMul;
+	procedure.Instructions.push_back({ VEC,operation,(word_t)GetSize(arrayTypes[0]) });
+}
+
 void CCodeGenerator::PrintStatement(SProcedure& procedure)
 {
 	Match("print");
@@ -679,6 +1410,24 @@ void CCodeGenerator::PrintStatement(SProcedure& procedure)
 	Match(")");
 }
 
+void CCodeGenerator::FreeStatement(SProcedure& procedure)
+{
+	Match("free");
+	Match("(");
+	SValue value = Expression(procedure, procedure.Instructions);
+	if (value.Type.Type != EType::Pointer || value.ArraySize) {
+		Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": free requires a pointer returned by new");
+	}
+	Match(")");
+	procedure.Instructions.push_back({ FRE,0,0 });
+}
+
+void CCodeGenerator::SnapshotStatement(SProcedure& procedure)
+{
+	Match("snapshot");
+	procedure.Instructions.push_back({ SNP,0,0 });
+}
+
 void CCodeGenerator::Condition(SProcedure& procedure)
 {
 	if (GetNextTerminatorType() == "odd") {
@@ -756,7 +1505,7 @@ SValue CCodeGenerator::Expression(SProcedure& procedure, std::vector<Instruction
 				instructions.push_back({ OPR,0,Add });
 			}
 			else if (value.Type.Type == EType::Pointer && nextValue.Type.Type == EType::Integer) {
-				instructions.push_back({ LIT,0,(int32_t)GetSize(*value.Type.InnerType) });
+				instructions.push_back({ LIT,0,(word_t)GetSize(*value.Type.InnerType) });
 				instructions.push_back({ OPR,0,Mul });
 				instructions.push_back({ OPR,0,Add });
 			}
@@ -773,7 +1522,7 @@ SValue CCodeGenerator::Expression(SProcedure& procedure, std::vector<Instruction
 				instructions.push_back({ OPR,0,Sub });
 			}
 			else if (value.Type.Type == EType::Pointer && nextValue.Type.Type == EType::Integer) {
-				instructions.push_back({ LIT,0,(int32_t)GetSize(*value.Type.InnerType) });
+				instructions.push_back({ LIT,0,(word_t)GetSize(*value.Type.InnerType) });
 				instructions.push_back({ OPR,0,Mul });
 				instructions.push_back({ OPR,0,Sub });
 			}
@@ -781,12 +1530,23 @@ SValue CCodeGenerator::Expression(SProcedure& procedure, std::vector<Instruction
 				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": cannot sub such types of values");
 			}
 		}
+		else if (AdditiveOperators.contains(nextTerminatorType)) {
+			Match(nextTerminatorType);
+			nextValue = Term(procedure, instructions);
+
+			if (value.Type.Type != EType::Integer || nextValue.Type.Type != EType::Integer) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": operator " + nextTerminatorType + " requires integers");
+			}
+			instructions.push_back({ OPR,0,AdditiveOperators.at(nextTerminatorType) });
+		}
 		else {
 			break;
 		}
+		value.ArraySize = 0;	//Ľ
 	}
 
-	value.bIsConst = false;
+	//תõָȻ¼ǷǳڼĿ
+	if (value.ArraySize == 0) value.bIsConst = false;
 	return value;
 }
 
@@ -818,9 +1578,19 @@ SValue CCodeGenerator::Term(SProcedure& procedure, std::vector<Instruction>& ins
 			}
 			instructions.push_back({ OPR,0,Div });
 		}
+		else if (MultiplicativeOperators.contains(nextTerminatorType)) {
+			Match(nextTerminatorType);
+			nextValue = Factor(procedure, instructions);
+
+			if (value.Type.Type != EType::Integer || nextValue.Type.Type != EType::Integer) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": operator " + nextTerminatorType + " requires integers");
+			}
+			instructions.push_back({ OPR,0,MultiplicativeOperators.at(nextTerminatorType) });
+		}
 		else {
 			break;
 		}
+		value.ArraySize = 0;
 	}
 
 	return value;
@@ -845,13 +1615,14 @@ SValue CCodeGenerator::Factor(SProcedure& procedure, std::vector<Instruction>& i
 			//飬תΪָ
 			if (type.Type == EType::Array) {
 				type.Type = EType::Pointer;
-				value.bIsConst = false;
-				instructions.push_back({ LOA,levelDiff,(int32_t)offset });
+				value.bIsConst = isConst;
+				value.ArraySize = type.ArraySize;
+				instructions.push_back({ LOA,levelDiff,(word_t)offset });
 			}
 			//ֱָȡӦڴλõֵ
 			else {
 				value.bIsConst = isConst;
-				instructions.push_back({ LOD,levelDiff,(int32_t)offset });
+				instructions.push_back({ LOD,levelDiff,(word_t)offset });
 			}
 			value.Type = type;
 
@@ -879,23 +1650,25 @@ SValue CCodeGenerator::Factor(SProcedure& procedure, std::vector<Instruction>& i
 					Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": cannot index a non-pointer type");
 				}
 
-				instructions.push_back({ LIT,0,(int32_t)GetSize(*value.Type.InnerType) });
+				instructions.push_back({ LIT,0,(word_t)GetSize(*value.Type.InnerType) });
 				instructions.push_back({ OPR,0,Mul });
 				instructions.push_back({ OPR,0,Add });
 
 				value.Type = *value.Type.InnerType;
+				value.ArraySize = value.Type.Type == EType::Array ? value.Type.ArraySize : 0;
 				if (value.Type.Type != EType::Array)
 					instructions.push_back({ LOR,0,0 });
 				else
 					value.Type.Type = EType::Pointer;
 
-				value.bIsConst = false;
+				//ԪҲǳvalue.bIsConstѾΪfalse
+				value.bIsUntypedPointer = false;
 			}
 			else break;
 		}
 	}
 	else if (nextTerminatorType == "number") {
-		int32_t numberValue;
+		word_t numberValue;
 		Match("number", &numberValue);
 		value.Type.Type = EType::Integer;
 		value.bIsConst = false;
@@ -924,7 +1697,10 @@ SValue CCodeGenerator::Factor(SProcedure& procedure, std::vector<Instruction>& i
 
 		value.Type = *nextValue.Type.InnerType;
 		value.bIsConst = false;
-		if (value.Type.Type == EType::Array) value.Type.Type = EType::Pointer;
+		if (value.Type.Type == EType::Array) {
+			value.ArraySize = value.Type.ArraySize;
+			value.Type.Type = EType::Pointer;
+		}
 		else instructions.push_back({ LOR,0,0 });
 	}
 	else if (nextTerminatorType == "&") {
@@ -942,8 +1718,11 @@ SValue CCodeGenerator::Factor(SProcedure& procedure, std::vector<Instruction>& i
 		std::string terminatortype = GetNextTerminatorType();
 		if (terminatortype == "number")
 		{
-			int num;
+			word_t num;
 			Match("number", &num);
+			if (num == 0) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": random bound must be positive");
+			}
 			instructions.push_back({ RAN_N,0,num });
 
 		}
@@ -955,6 +1734,92 @@ SValue CCodeGenerator::Factor(SProcedure& procedure, std::vector<Instruction>& i
 		value.Type = { EType::Integer };
 		value.bIsConst = false;
 	}
+	else if (nextTerminatorType == "min" || nextTerminatorType == "max" || nextTerminatorType == "abs") {
+		//úmin(a, b)max(a, b)abs(a)
+		std::string functionName = nextTerminatorType;
+		Match(functionName);
+		Match("(");
+		bool isInteger = Expression(procedure, instructions).Type.Type == EType::Integer;
+		if (functionName != "abs") {
+			Match(",");
+			isInteger = Expression(procedure, instructions).Type.Type == EType::Integer && isInteger;
+		}
+		Match(")");
+		if (!isInteger) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": " + functionName + " requires integers");
+		}
+
+		instructions.push_back({ OPR,0,functionName == "min" ? Min : functionName == "max" ? Max : Abs });
+		value.Type = { EType::Integer };
+		value.bIsConst = false;
+	}
+	else if (nextTerminatorType == "new") {
+		//únew(n)ڶϷnԪõָԸֵ͵ָ
+		Match("new");
+		Match("(");
+		if (Expression(procedure, instructions).Type.Type != EType::Integer) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": new requires an integer size");
+		}
+		Match(")");
+
+		instructions.push_back({ NEW,0,0 });
+		value.Type = SType{ EType::Pointer,std::make_shared<SType>(SType{ EType::Integer }) };
+		value.bIsConst = false;
+		value.bIsUntypedPointer = true;
+	}
+	else if (nextTerminatorType == "read") {
+		//úread()жȡһ
+		Match("read");
+		Match("(");
+		Match(")");
+
+		instructions.push_back({ RED,0,0 });
+		value.Type = { EType::Integer };
+		value.bIsConst = false;
+	}
+	else if (nextTerminatorType == "readarray") {
+		//úreadarray(a, n)ȡnaĿͷõʵʶĸʱn
+		Match("readarray");
+		Match("(");
+		SType arrayType;
+		ArrayOperand(procedure, instructions, arrayType, true);
+		if (GetElementType(arrayType).Type != EType::Integer) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": readarray requires an integer array");
+		}
+		Match(",");
+		if (Expression(procedure, instructions).Type.Type != EType::Integer) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": readarray requires an integer count");
+		}
+		Match(")");
+
+		instructions.push_back({ RDA,0,(word_t)GetSize(arrayType) });
+		value.Type = { EType::Integer };
+		value.bIsConst = false;
+	}
+	else if (nextTerminatorType == "vsum" || nextTerminatorType == "vdot") {
+		//úvsum(a)vdot(a, b)͡
+		std::string functionName = nextTerminatorType;
+		Match(functionName);
+		Match("(");
+		SType arrayType;
+		ArrayOperand(procedure, instructions, arrayType);
+		if (functionName == "vdot") {
+			Match(",");
+			SType otherArrayType;
+			ArrayOperand(procedure, instructions, otherArrayType);
+			if (GetSize(otherArrayType) != GetSize(arrayType)) {
+				Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": vdot requires arrays of the same size");
+			}
+		}
+		Match(")");
+		if (GetElementType(arrayType).Type != EType::Integer) {
+			Error("Line " + std::to_string(TerminatorSequence[CurrentIndex - 1].Line) + ": " + functionName + " requires integer arrays");
+		}
+
+		instructions.push_back({ VEC,functionName == "vsum" ? VecSum : VecDot,(word_t)GetSize(arrayType) });
+		value.Type = { EType::Integer };
+		value.bIsConst = false;
+	}
 	else {
 		Error("Expected a factor on line " + std::to_string(TerminatorSequence[CurrentIndex].Line));
 	}
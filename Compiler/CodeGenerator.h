@@ -1,9 +1,14 @@
 #pragma once
 #include <memory>
+#include <ostream>
 #include <cstdint>
+#include <filesystem>
+#include <map>
 #include "LexicalAnalyzer.h"
 #include "Instruction.h"
 #include "Type.h"
+#include "Executable.h"
+#include "ObjectFile.h"
 
 struct SScopedIdentifier {
 	std::vector<std::string> Identifiers;
@@ -31,6 +36,8 @@ struct SVariable {
 struct SValue {
 	SType Type;
 	bool bIsConst;
+	uint32_t ArraySize{};		//ֵתõָ룬ΪĴСһάԪظΪ0
+	bool bIsUntypedPointer{};	//Ƿnewõָ룬Ըֵ͵ָ
 };
 
 //һӳ
@@ -46,11 +53,27 @@ struct SProcedure
 
 	std::vector<Instruction> Instructions;
 	uint32_t Address;						//ӳڵַ
+	uint32_t StatementOffset{};				//䲿Instructionsеʼλã֮ǰΪռָ
+	uint32_t NumTemporaries{};				//Żʱջ֡жʱĸ
+	word_t CaseSelectorOffset{ -1 };		//case䰴Ƚʱѡʽֵʱ-1δ
+
+	bool bNeedsStaticLink{ true };			//ǷҪ̬Ҫ̬ӳCAL_v2ãջ֡ͷֻDLRA
+	bool bIsForallBody{};					//Ƿforallѭ壻ѭһӳջ֡ƫ3ѭ
+	std::vector<SLineEntry> Lines;			//кűƫСУŻؽָʱһ
+	std::vector<uint32_t> GlobalReferences;	//ӳаԵַջָ֡LDGLOAõLITԼSTOSTO_v2ƫģʱݴضλ
 };
 /*
 ĲΪ0ľֲĲΪ0
 */
 
+//ģ
+struct SImportedModule {
+	std::string Name;
+	std::shared_ptr<const SObjectFile> Object;
+	uint32_t DataAddress;					//ģջ֡еƫ
+	std::vector<std::shared_ptr<SProcedure>> Procedures;	//ģ鵼ӳֻŻûָ
+};
+
 //ڼ¼CALָȴ
 struct SCallIntruction {
 	SProcedure* Procedure;					//ָڵӳ
@@ -65,10 +88,21 @@ private:
 	const std::vector<STerminator>& TerminatorSequence;	//Ĵʷ
 	uint32_t CurrentIndex{};							//ǰĴʷ±
 	std::vector<Instruction> Instructions;				//յõָ
+	std::vector<word_t> Data;							//ݶΣջ֡дƫ3ʼıͳĳʼֵ
 
 	std::vector<std::shared_ptr<SProcedure>> Procedures;//еӳstd::vectorʱƶڴ棬ʹָ
 	std::vector<SCallIntruction> CallInstructions;		//еĵָڻ
 
+	bool bIsModule{};									//Դļģ飬Ŀļǿִļ
+	std::string ModuleName;
+	std::vector<std::filesystem::path> ModuleSearchPath;	//ҵģĿļĿ¼
+	std::map<std::string, std::shared_ptr<const SObjectFile>> PreloadedModules;
+	std::vector<SImportedModule> ImportedModules;
+	SObjectFile Object;									//ģĿļڳ֮ǰĳ
+	std::string SourceFile;								//Դļ·¼Ŀļͷű
+	uint32_t CurrentLine{};								//ǰڵУ֮ɵָһ
+	SSymbolTable Symbols;								//Ӻķű
+
 	/*
 	* һЩ
 	*/
@@ -82,6 +116,13 @@ private:
 	void FindVariable(SProcedure& procedure, const SScopedIdentifier& scopedIdentifier, SType& type, int16_t& levelDiff, uint32_t& offset, bool& isConst);
 	//FindVariable
 	void FindSubProcedure(SProcedure& procedure, uint32_t identTerminatorIndex, SProcedure*& calledProcedure, int16_t& levelDiff);
+	//ڵģвӳmoduleNameΪʱеģ飻Ҳʱfalse
+	//ӳ൱ӳ򣬿κεط
+	bool FindImportedProcedure(SProcedure& procedure, const std::string& moduleName, const std::string& procedureName, SProcedure*& calledProcedure, int16_t& levelDiff);
+	//֮procedureɵָCurrentLine¼procedure.Lines
+	void MarkLine(SProcedure& procedure);
+	//Żӳ͵ָObject
+	void BuildObject();
 	//ֵʽָתΪֵ
 	void TurnRightValueToLeftValue(std::vector<Instruction>& instructions, const SValue& value);
 
@@ -89,9 +130,13 @@ private:
 	* ﷨
 	*/
 	void Program();
+	//module name; ֻ֮гӳû
+	void ModuleDeclare();
+	//import a, b; ջ֡Ϊÿģݷռ
+	void ImportDeclare(SProcedure& main);
 
 	//ƥһսǱʶֵ֣浽numverValueidentifierName
-	void Match(const std::string& type, int32_t* numverValue = nullptr, std::string* identifierName = nullptr);
+	void Match(const std::string& type, word_t* numverValue = nullptr, std::string* identifierName = nullptr);
 	//ƥһıʶҲԲ򣩣scopedIdentifier
 	void ScopedIdentifier(SScopedIdentifier& scopedIdentifier);
 	void Procedure(SProcedure& procedure);
@@ -108,7 +153,24 @@ private:
 	void BeginEndStatement(SProcedure& procedure);
 	void IfStatement(SProcedure& procedure);
 	void WhileStatement(SProcedure& procedure);
+	//for i := a to b [step c] doѭǵǰӳıǳ
+	void ForStatement(SProcedure& procedure);
+	//case expr of c1, c2: stmt; ... else stmt; endűǳ
+	//ųʱJTBתɣöֲҵıȽ
+	void CaseStatement(SProcedure& procedure);
+	//forall i := a to b do [var ...;] stmtεɽִУѭΪһӳFALָ
+	//ѭѭԼıѭвֱӸļ򵥱ֵεӦ
+	void ForallStatement(SProcedure& procedure);
 	void PrintStatement(SProcedure& procedure);
+	//free(p)ͷnewõָ
+	void FreeStatement(SProcedure& procedure);
+	//snapshotִеʱ״̬дļ֮Դӿֱӻָ֮ǰĳʼ
+	void SnapshotStatement(SProcedure& procedure);
+	//vcopy(dst, src)vfill(dst, v)vadd/vsub/vmul(dst, a, b)
+	void VectorStatement(SProcedure& procedure);
+	//Ĳ飨תõָ룩ͱarrayType
+	//isDestinationΪtrueʱ鲻ǳ
+	void ArrayOperand(SProcedure& procedure, std::vector<Instruction>& instructions, SType& arrayType, bool isDestination = false);
 	void Condition(SProcedure& procedure);
 	void OddCondition(SProcedure& procedure);
 	void CompareCondition(SProcedure& procedure);
@@ -121,18 +183,36 @@ private:
 	//ӣisLeftValue=falseִָϺջΪӵִֵָ֮ϺջΪֵĵַ
 	SValue Factor(SProcedure& procedure, std::vector<Instruction>& instructions, bool isLeftValue = false);
 	/*
-	ģRAΪ0RETʱ˳
-	ڽͳʼʱֶջѹ0ռDLSLRAλ
+	ģջ֡ɽDLSLΪ0RAΪָĩβ׷ӵHLTָĵַ
+	ִRETʱصHLTָִ֮
 	*/
 
 public:
 	CCodeGenerator(const std::vector<STerminator>& terminatorSequence);
+	//importʱЩĿ¼βģĿļ
+	void SetModuleSearchPath(const std::vector<std::filesystem::path>& searchPath);
+	//ԤȶȡģĿļimportģʱֱʹ
+	void SetModule(const std::string& moduleName, std::shared_ptr<const SObjectFile> object);
+	//Դļ·ֻڷűеļ
+	void SetSourceFile(const std::string& sourceFile);
 
 	//ͬʱ﷨ɣɵָбInstructions
 	void GenerateCode();
 
 	void PrintInstructions();
 
-	//Instructionsеָļ
+	//ļͷInstructionsеָкݶļУģĿļ
 	void Output(const std::string& FileName);
+	void Output(std::ostream& out);
+	//ķűʽSSymbolTable
+	void OutputSymbols(std::ostream& out);
+
+	//ݶջ֡еʼƫDLSLRA֮
+	static constexpr uword_t DataAddress = 3;
+	//ɵָкݶΣԲļֱӽִ
+	const std::vector<Instruction>& GetInstructions() const;
+	const std::vector<word_t>& GetData() const;
+	bool IsModule() const;
+	const SObjectFile& GetObject() const;
+	const SSymbolTable& GetSymbols() const;
 };
@@ -0,0 +1,211 @@
+#include "CompileCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <vector>
+#include "Instruction.h"
+
+//ļļͷ֮ΪļͿִļ
+struct SCacheEntryHeader
+{
+	uint32_t Magic;
+	uint32_t Reserved;
+	uint64_t KeySize;
+	uint64_t ExecutableSize;
+};
+constexpr uint32_t CacheEntryMagic = 0x43304C50;	//"PL0C"
+static const char* const EntryExtension = ".pl0c";
+
+static std::string ReadEnvironment(const char* name)
+{
+#ifdef _WIN32
+	char* value{};
+	size_t size;
+	if (_dupenv_s(&value, &size, name) != 0 || !value) return {};
+	std::string result = value;
+	free(value);
+	return result;
+#else
+	const char* value = std::getenv(name);
+	return value ? value : "";
+#endif
+}
+
+CCompileCache::CCompileCache(const std::filesystem::path& directory, uint64_t maxSize) : Directory(directory), MaxSize(maxSize)
+{
+	std::error_code error;
+	std::filesystem::create_directories(Directory, error);
+}
+
+std::filesystem::path CCompileCache::GetDefaultDirectory()
+{
+	std::string directory = ReadEnvironment("PL0_CACHE_DIR");
+	if (!directory.empty()) return directory;
+#ifdef _WIN32
+	directory = ReadEnvironment("LOCALAPPDATA");
+	if (!directory.empty()) return std::filesystem::path(directory) / "pl0";
+#else
+	directory = ReadEnvironment("XDG_CACHE_HOME");
+	if (!directory.empty()) return std::filesystem::path(directory) / "pl0";
+	directory = ReadEnvironment("HOME");
+	if (!directory.empty()) return std::filesystem::path(directory) / ".cache" / "pl0";
+#endif
+	return {};
+}
+
+std::string CCompileCache::MakeKey(const std::string& source, const std::vector<std::pair<std::string, std::string>>& modules)
+{
+	std::string key = CompilerVersion;
+	key += '\0';
+	key += std::to_string(WordBits) + "-bit";
+	key += '\0';
+	key += std::to_string(source.size());
+	key += '\0';
+	key += source;
+	//ģǰдϳȣͬĻֲõͬļ
+	for (auto& [moduleName, object] : modules) {
+		key += '\0' + moduleName + '\0' + std::to_string(object.size()) + '\0';
+		key += object;
+	}
+	return key;
+}
+
+std::filesystem::path CCompileCache::GetEntryPath(const std::string& key) const
+{
+	//FNV-1a
+	uint64_t hash = 0xCBF29CE484222325;
+	for (unsigned char c : key) {
+		hash = (hash ^ c) * 0x100000001B3;
+	}
+	std::ostringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << hash << EntryExtension;
+	return Directory / name.str();
+}
+
+void CCompileCache::Count(const char* statsFile)
+{
+	std::ofstream file(Directory / statsFile, std::ios::binary | std::ios::app);
+	file.put('.');
+}
+
+bool CCompileCache::Lookup(const std::string& key, std::string& executable)
+{
+	std::filesystem::path path = GetEntryPath(key);
+	bool hit{};
+	std::ifstream file(path, std::ios::binary);
+	if (file.is_open()) {
+		file.seekg(0, std::ios::end);
+		uint64_t fileSize = (uint64_t)file.tellg();
+		file.seekg(0, std::ios::beg);
+		SCacheEntryHeader header{};
+		file.read((char*)&header, sizeof(header));
+		if (file && header.Magic == CacheEntryMagic && header.KeySize == key.size()
+			&& header.ExecutableSize == fileSize - sizeof(header) - header.KeySize)
+		{
+			std::string storedKey(key.size(), '\0');
+			file.read(storedKey.data(), storedKey.size());
+			if (file && storedKey == key) {
+				executable.resize(header.ExecutableSize);
+				file.read(executable.data(), executable.size());
+				hit = (bool)file;
+			}
+		}
+	}
+
+	if (hit) {
+		//¼ʹã̭ʱʱ
+		std::error_code error;
+		std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+	}
+	Count(hit ? "hits" : "misses");
+	return hit;
+}
+
+void CCompileCache::Store(const std::string& key, const std::string& executable, bool evict)
+{
+	std::filesystem::path path = GetEntryPath(key);
+	//ʱļѡȡͬʱдͬһĽ̲ụӰ죬ļ
+	std::ostringstream suffix;
+	suffix << '.' << std::hex << std::random_device{}() << std::random_device{}() << ".tmp";
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += suffix.str();
+
+	std::error_code error;
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		SCacheEntryHeader header{ CacheEntryMagic,0,key.size(),executable.size() };
+		file.write((const char*)&header, sizeof(header));
+		file.write(key.data(), key.size());
+		file.write(executable.data(), executable.size());
+		file.close();
+		if (!file) {
+			std::filesystem::remove(temporaryPath, error);
+			return;
+		}
+	}
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		std::filesystem::remove(temporaryPath, error);
+		return;
+	}
+	if (evict) Evict();
+}
+
+void CCompileCache::Evict()
+{
+	struct SEntry {
+		std::filesystem::file_time_type LastUsed;
+		uint64_t Size;
+		std::filesystem::path Path;
+	};
+	std::vector<SEntry> entries;
+	uint64_t totalSize{};
+	std::error_code error;
+	for (auto& item : std::filesystem::directory_iterator(Directory, error)) {
+		if (item.path().extension() != EntryExtension) continue;
+		std::error_code itemError;
+		uint64_t size = item.file_size(itemError);
+		auto lastUsed = item.last_write_time(itemError);
+		if (itemError) continue;
+		entries.push_back({ lastUsed,size,item.path() });
+		totalSize += size;
+	}
+	if (totalSize <= MaxSize) return;
+
+	//̿ͬʱ̭ɾʧʱټ
+	std::sort(entries.begin(), entries.end(), [](const SEntry& a, const SEntry& b) { return a.LastUsed < b.LastUsed; });
+	for (auto& entry : entries) {
+		if (totalSize <= MaxSize) break;
+		std::filesystem::remove(entry.Path, error);
+		totalSize -= entry.Size;
+	}
+}
+
+void CCompileCache::PrintStats(std::ostream& out)
+{
+	uint64_t numEntries{};
+	uint64_t totalSize{};
+	std::error_code error;
+	for (auto& item : std::filesystem::directory_iterator(Directory, error)) {
+		if (item.path().extension() != EntryExtension) continue;
+		std::error_code itemError;
+		uint64_t size = item.file_size(itemError);
+		if (itemError) continue;
+		numEntries++;
+		totalSize += size;
+	}
+	uint64_t hits = std::filesystem::file_size(Directory / "hits", error);
+	if (error) hits = 0;
+	uint64_t misses = std::filesystem::file_size(Directory / "misses", error);
+	if (error) misses = 0;
+
+	out << "========= Compile cache =========" << std::endl;
+	out << "directory: " << Directory.string() << std::endl;
+	out << "entries: " << numEntries << ", size: " << totalSize / 1024 << " KB of " << MaxSize / (1024 * 1024) << " MB" << std::endl;
+	out << std::fixed << std::setprecision(1);
+	out << "hits: " << hits << ", misses: " << misses << " (hit rate " << (hits + misses ? 100.0 * hits / (hits + misses) : 0.0) << "%)" << std::endl;
+	out << std::defaultfloat;
+}
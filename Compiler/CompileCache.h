@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//İ汾޸ɵĴʱҪ޸ģʹ֮ǰĽʧЧ
+constexpr const char* CompilerVersion = "pl0-compiler-8";
+
+/*
+Ļ棺Դļģݡİ汾ѡΪ֮ǰɵĿִļʱҪʷʹ
+ÿǻĿ¼еһļļΪĹϣлļϣͬͬʱΪû
+дʱдʱļٸͬʱʹͬһĿ¼Ҳдһļ
+ļ޸ʱ¼һʹõʱ䣬ܴСʱɾûʹõĽ
+κδʱûУӰ
+*/
+class CCompileCache
+{
+private:
+	std::filesystem::path Directory;
+	uint64_t MaxSize;						//нܴСޣλΪֽ
+
+	std::filesystem::path GetEntryPath(const std::string& key) const;
+	//СδеĴֱΪͳļĴС׷һֽڼɼҪ
+	void Count(const char* statsFile);
+
+public:
+	static constexpr uint64_t DefaultMaxSize = (uint64_t)256 << 20;	//256MB
+
+	//Ŀ¼ʱ
+	CCompileCache(const std::filesystem::path& directory, uint64_t maxSize = DefaultMaxSize);
+	//PL0_CACHE_DIRûʱΪûĻĿ¼µpl0ûʱؿ·
+	static std::filesystem::path GetDefaultDirectory();
+	//Դļݵõаİ汾ֳԼĸģֺĿļ
+	static std::string MakeKey(const std::string& source, const std::vector<std::pair<std::string, std::string>>& modules = {});
+
+	//ҼӦĿִļʱtrue
+	bool Lookup(const std::string& key, std::string& executable);
+	//ӦĿִļevictΪfalseʱܴСɵ֮Evict
+	void Store(const std::string& key, const std::string& executable, bool evict = true);
+	//ɾûʹõĽֱܴС
+	void Evict();
+	//ĸܴСԼСδеĴ
+	void PrintStats(std::ostream& out);
+};
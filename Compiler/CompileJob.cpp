@@ -0,0 +1,247 @@
+#include "CompileJob.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <thread>
+#include "LexicalAnalyzer.h"
+#include "CodeGenerator.h"
+#include "Utils.h"
+
+CCompileJob::CCompileJob(uint32_t numThreads, bool printInstructions) : NumThreads(numThreads), bPrintInstructions(printInstructions)
+{
+	if (NumThreads == 0) NumThreads = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+	//ָܽ
+	if (bPrintInstructions) NumThreads = 1;
+}
+
+void CCompileJob::SetCache(const std::filesystem::path& cacheDirectory, uint64_t maxSize)
+{
+	Cache = std::make_unique<CCompileCache>(cacheDirectory, maxSize);
+}
+
+void CCompileJob::AddModuleDirectory(const std::filesystem::path& directory)
+{
+	ModuleDirectories.push_back(directory);
+}
+
+void CCompileJob::EnableSymbols()
+{
+	bWriteSymbols = true;
+}
+
+void CCompileJob::AddUnit(const std::string& sourceFile, const std::string& outputFile)
+{
+	Units.push_back({ sourceFile,outputFile });
+}
+
+bool CCompileJob::ReadManifest(const std::string& manifestFile, std::string& errorMessage)
+{
+	std::ifstream file(manifestFile);
+	if (!file.is_open()) {
+		errorMessage = "Cannot open manifest: " + manifestFile;
+		return false;
+	}
+
+	std::string line;
+	for (size_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+		std::istringstream fields(line);
+		std::string sourceFile, outputFile, extra;
+		if (!(fields >> sourceFile) || sourceFile[0] == '#') continue;
+		if (!(fields >> outputFile)) {
+			errorMessage = manifestFile + ":" + std::to_string(lineNumber) + ": missing output file";
+			return false;
+		}
+		if (fields >> extra) {
+			errorMessage = manifestFile + ":" + std::to_string(lineNumber) + ": unexpected field: " + extra;
+			return false;
+		}
+		AddUnit(sourceFile, outputFile);
+	}
+	return true;
+}
+
+size_t CCompileJob::GetNumUnits() const
+{
+	return Units.size();
+}
+
+void CCompileJob::ReadUnit(SCompileUnit& unit)
+{
+	std::ifstream sourceFile{ unit.SourceFile,std::ios::binary };
+	if (!sourceFile.is_open()) {
+		unit.ErrorMessage = "Cannot open file: " + unit.SourceFile;
+		return;
+	}
+	unit.Source.assign(std::istreambuf_iterator<char>(sourceFile), std::istreambuf_iterator<char>{});
+	unit.SourceSize = unit.Source.size();
+	ScanModuleHeader(unit.Source, unit.bIsModule, unit.Imports);
+}
+
+//дʱļٸͬʱĳ򲻻дһĿļ
+static void WriteOutputFile(const std::string& fileName, const std::string& content)
+{
+	std::filesystem::path temporaryFile = fileName + ".tmp";
+	std::ofstream outputFile{ temporaryFile,std::ios::binary };
+	if (!outputFile.is_open()) {
+		Error("Cannot open file " + fileName);
+	}
+	outputFile.write(content.data(), content.size());
+	outputFile.close();
+	std::error_code error;
+	if (outputFile) std::filesystem::rename(temporaryFile, fileName, error);
+	if (!outputFile || error) {
+		std::filesystem::remove(temporaryFile, error);
+		Error("Cannot write file " + fileName);
+	}
+}
+
+void CCompileJob::CompileUnit(SCompileUnit& unit)
+{
+	try {
+		//ģԴļڵĿ¼в
+		std::vector<std::filesystem::path> searchPath{ std::filesystem::path(unit.SourceFile).parent_path() };
+		if (searchPath[0].empty()) searchPath[0] = ".";
+		searchPath.insert(searchPath.end(), ModuleDirectories.begin(), ModuleDirectories.end());
+
+		//Դļ͵ģ鶼֮ǰͬʱֱʹûĽҪָʱ±
+		//ȡģʱʹû棬ɴɱ󣻷űִļֱ𻺴棬߶ʱŲҪ
+		//Ŀļͷűм¼Դļ·ǵļҲ·
+		bool writeSymbols = bWriteSymbols && !unit.bIsModule;
+		std::string cacheKey;
+		std::string symbolsKey;
+		std::string executable;
+		std::string symbols;
+		std::map<std::string, std::shared_ptr<const SObjectFile>> modules;
+		if (Cache) {
+			std::vector<std::pair<std::string, std::string>> moduleContents;
+			for (auto& moduleName : unit.Imports) {
+				std::string content, errorMessage;
+				auto object = LoadModule(moduleName, searchPath, content, errorMessage);
+				if (!object) break;
+				modules[moduleName] = object;
+				moduleContents.emplace_back(moduleName, std::move(content));
+			}
+			if (modules.size() == unit.Imports.size()) {
+				cacheKey = CCompileCache::MakeKey(unit.Source, moduleContents);
+				if (unit.bIsModule) cacheKey += "module " + unit.SourceFile;
+				symbolsKey = cacheKey + "symbols " + unit.SourceFile;
+				unit.bCached = !bPrintInstructions && Cache->Lookup(cacheKey, executable)
+					&& (!writeSymbols || Cache->Lookup(symbolsKey, symbols));
+			}
+		}
+		std::string().swap(unit.Source);
+
+		if (!unit.bCached) {
+			CLexicalAnalyzer LexicalAnalyzer{ unit.SourceFile };
+			LexicalAnalyzer.LexicalAnalyze();
+			CCodeGenerator CodeGenerator{ LexicalAnalyzer.GetTerminatorSequence() };
+			CodeGenerator.SetSourceFile(unit.SourceFile);
+			CodeGenerator.SetModuleSearchPath(searchPath);
+			for (auto& [moduleName, object] : modules) {
+				CodeGenerator.SetModule(moduleName, object);
+			}
+			CodeGenerator.GenerateCode();
+			if (bPrintInstructions) {
+				if (Units.size() > 1) std::cout << "========= " << unit.SourceFile << " =========" << std::endl;
+				CodeGenerator.PrintInstructions();
+			}
+			std::ostringstream out;
+			CodeGenerator.Output(out);
+			executable = out.str();
+			if (writeSymbols) {
+				std::ostringstream symbolsOut;
+				CodeGenerator.OutputSymbols(symbolsOut);
+				symbols = symbolsOut.str();
+			}
+			//һαԴļʱͳһ̭
+			if (!cacheKey.empty()) {
+				Cache->Store(cacheKey, executable, Units.size() == 1);
+				if (writeSymbols) Cache->Store(symbolsKey, symbols, Units.size() == 1);
+			}
+		}
+
+		WriteOutputFile(unit.OutputFile, executable);
+		if (writeSymbols) WriteOutputFile(unit.OutputFile + ".sym", symbols);
+		unit.bSucceeded = true;
+	}
+	catch (const CCompileError& error) {
+		unit.ErrorMessage = error.what();
+	}
+}
+
+void CCompileJob::RunInParallel(const std::vector<size_t>& indices, void (CCompileJob::* task)(SCompileUnit&))
+{
+	//ÿ߳ÿȡһûдԴļԴļСͬʱҲܾȷ
+	std::atomic<size_t> next{};
+	auto worker = [&] {
+		for (size_t i = next++; i < indices.size(); i = next++) {
+			(this->*task)(Units[indices[i]]);
+		}
+	};
+	uint32_t numThreads = (uint32_t)std::min<size_t>(NumThreads, indices.size());
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < numThreads; i++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void CCompileJob::Run(std::ostream& errors)
+{
+	auto startTime = std::chrono::steady_clock::now();
+	std::vector<size_t> all(Units.size());
+	for (size_t i{}; i < Units.size(); i++) {
+		all[i] = i;
+	}
+	RunInParallel(all, &CCompileJob::ReadUnit);
+
+	//ģڳ
+	std::vector<size_t> modules, programs;
+	for (size_t i{}; i < Units.size(); i++) {
+		if (!Units[i].ErrorMessage.empty()) continue;
+		(Units[i].bIsModule ? modules : programs).push_back(i);
+	}
+	RunInParallel(modules, &CCompileJob::CompileUnit);
+	RunInParallel(programs, &CCompileJob::CompileUnit);
+	if (Cache && Units.size() > 1) Cache->Evict();
+	Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	//嵥˳߳޹
+	for (auto& unit : Units) {
+		if (unit.bSucceeded) continue;
+		if (Units.size() > 1) errors << unit.SourceFile << ": ";
+		errors << "Error: " << unit.ErrorMessage << std::endl;
+	}
+}
+
+void CCompileJob::PrintReport(std::ostream& out) const
+{
+	size_t numSucceeded = std::count_if(Units.begin(), Units.end(), [](const SCompileUnit& unit) { return unit.bSucceeded; });
+	size_t numCached = std::count_if(Units.begin(), Units.end(), [](const SCompileUnit& unit) { return unit.bCached; });
+	uint64_t sourceSize{};
+	for (auto& unit : Units) {
+		sourceSize += unit.SourceSize;
+	}
+	out << "========= Compilation finished =========" << std::endl;
+	out << "files: " << Units.size() << ", succeeded: " << numSucceeded << ", failed: " << Units.size() - numSucceeded
+		<< ", from cache: " << numCached << std::endl;
+	out << "threads: " << std::min<size_t>(NumThreads, Units.size()) << std::endl;
+	out << std::fixed << std::setprecision(3) << "time: " << Seconds << " s, ";
+	out << std::setprecision(1) << (Seconds > 0 ? Units.size() / Seconds : 0.0) << " files/s, "
+		<< (Seconds > 0 ? sourceSize / Seconds / (1024 * 1024) : 0.0) << " MB/s of source" << std::endl;
+	out << std::defaultfloat;
+}
+
+bool CCompileJob::AllSucceeded() const
+{
+	return std::all_of(Units.begin(), Units.end(), [](const SCompileUnit& unit) { return unit.bSucceeded; });
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CompileCache.h"
+
+//һҪԴļ
+struct SCompileUnit
+{
+	std::string SourceFile;
+	std::string OutputFile;
+
+	std::string Source;					//֮ǰȡͷ
+	bool bIsModule{};
+	std::vector<std::string> Imports;	//ģ
+
+	bool bSucceeded{};
+	bool bCached{};						//Ա뻺
+	std::string ErrorMessage;			//ʧʱĴϢ
+	uint64_t SourceSize{};
+};
+
+/*
+ԴļÿԴļĴʷɶֻʹԼ״̬ڶ߳ͬʱ
+Դļùȡķʽ䵽̣߳һԴļʱ¼ϢԴļ
+ȱеģ飬ٱͬʱĳܵɵĿļ
+*/
+class CCompileJob
+{
+private:
+	uint32_t NumThreads;
+	bool bPrintInstructions;
+	bool bWriteSymbols{};
+	std::unique_ptr<CCompileCache> Cache;	//Ϊʱʹñ뻺
+	std::vector<std::filesystem::path> ModuleDirectories;	//ԴļڵĿ¼֮ģĿ¼
+	std::vector<SCompileUnit> Units;
+	double Seconds{};					//Դļõʱ
+
+	//ȡԴļɨ迪ͷmoduleimport
+	void ReadUnit(SCompileUnit& unit);
+	void CompileUnit(SCompileUnit& unit);
+	//ڸ߳жUnits±ΪindicesԴļִtask
+	void RunInParallel(const std::vector<size_t>& indices, void (CCompileJob::* task)(SCompileUnit&));
+
+public:
+	//printInstructionsʱÿԴļɵָֻʹһ߳
+	CCompileJob(uint32_t numThreads, bool printInstructions);
+	//ʹcacheDirectoryеı뻺
+	void SetCache(const std::filesystem::path& cacheDirectory, uint64_t maxSize);
+	//importʱĿ¼вģĿļ
+	void AddModuleDirectory(const std::filesystem::path& directory);
+	//ͬʱΪÿдű"Ŀļ.sym"ܷʹ
+	void EnableSymbols();
+
+	void AddUnit(const std::string& sourceFile, const std::string& outputFile);
+	/*
+	ȡ嵥ÿΪ"Դļ Ŀļ"к#ͷб
+	嵥ʽܴʱfalseerrorMessageΪϢ
+	*/
+	bool ReadManifest(const std::string& manifestFile, std::string& errorMessage);
+	size_t GetNumUnits() const;
+
+	//ԴļÿԴļʱѴϢдerrors
+	void Run(std::ostream& errors);
+	//ԴļĸɹʧܵĸԼ
+	void PrintReport(std::ostream& out) const;
+	//Դļɹ
+	bool AllSucceeded() const;
+};
@@ -1,12 +1,13 @@
 ﻿#include <iostream>
-#include "GlobalVariable.h"
 #include "LexicalAnalyzer.h"
 #include "CodeGenerator.h"
+#include "CompileCache.h"
+#include "CompileJob.h"
 
 //用于测试词法分析器
-void LexicalAnalyzerTest()
+void LexicalAnalyzerTest(const std::string& sourceFilePath)
 {
-	CLexicalAnalyzer LexicalAnalyzer{ SourceFilePath };
+	CLexicalAnalyzer LexicalAnalyzer{ sourceFilePath };
 	LexicalAnalyzer.LexicalAnalyze();
 	auto TerminatorSequence = LexicalAnalyzer.GetTerminatorSequence();
 	for (auto& Terminator : TerminatorSequence) {
@@ -24,29 +25,111 @@ void LexicalAnalyzerTest()
 
 void ShowUsage() {
 	std::cout << "Usage: " << std::endl<<std::endl;
-	std::cout << "Compiler <SourceFilePath> <OutputFilePath>" << std::endl;
+	std::cout << "Compiler [options] <SourceFilePath> <OutputFilePath> [<SourceFilePath> <OutputFilePath> ...]" << std::endl;
+	std::cout << "Compiler [options] --manifest FILE" << std::endl;
+	std::cout << "Compiler [--cache-dir DIR] --cache-stats" << std::endl << std::endl;
+	std::cout << "--list         print the generated instructions" << std::endl;
+	std::cout << "--symbols      also write the symbol table of each program to <OutputFilePath>.sym, used by the profiler" << std::endl;
+	std::cout << "--jobs N       compile N files at the same time, default is the number of cores" << std::endl;
+	std::cout << "--manifest FILE compile the files listed in FILE, one \"source output\" pair per line" << std::endl;
+	std::cout << "--module-dir DIR also look for imported modules in DIR, after the directory of the source file" << std::endl;
+	std::cout << "--no-cache     always compile, without looking up or storing results in the compile cache" << std::endl;
+	std::cout << "--cache-dir DIR directory of the compile cache, default is $PL0_CACHE_DIR or the user's cache directory" << std::endl;
+	std::cout << "--cache-size MB maximum total size of the compile cache, default is 256" << std::endl;
+	std::cout << "--cache-stats  print the number of cached results and the hit rate" << std::endl;
 	exit(0);
 }
 
 int main(int argc,char** argv) {
 	
-	//从命令行参数中读取源文件路径和目标文件路径
-	if(argc != 3) {
-		ShowUsage();
+	//从命令行参数中读取选项以及成对的源文件路径和目标文件路径
+	bool printInstructions{};
+	bool writeSymbols{};
+	uint32_t numThreads{};
+	std::string manifestFile;
+	bool useCache = true;
+	bool printCacheStats{};
+	std::filesystem::path cacheDirectory = CCompileCache::GetDefaultDirectory();
+	uint64_t cacheSize = CCompileCache::DefaultMaxSize;
+	std::vector<std::filesystem::path> moduleDirectories;
+	int argIndex = 1;
+	while (argIndex < argc) {
+		std::string option = argv[argIndex];
+		if (option == "--list") {
+			printInstructions = true;
+			argIndex++;
+		}
+		else if (option == "--symbols") {
+			writeSymbols = true;
+			argIndex++;
+		}
+		else if (option == "--jobs" && argIndex + 1 < argc) {
+			int value = std::atoi(argv[argIndex + 1]);
+			if (value <= 0) ShowUsage();
+			numThreads = value;
+			argIndex += 2;
+		}
+		else if (option == "--manifest" && argIndex + 1 < argc) {
+			manifestFile = argv[argIndex + 1];
+			if (manifestFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--module-dir" && argIndex + 1 < argc) {
+			moduleDirectories.push_back(argv[argIndex + 1]);
+			if (moduleDirectories.back().empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--no-cache") {
+			useCache = false;
+			argIndex++;
+		}
+		else if (option == "--cache-stats") {
+			printCacheStats = true;
+			argIndex++;
+		}
+		else if (option == "--cache-dir" && argIndex + 1 < argc) {
+			cacheDirectory = argv[argIndex + 1];
+			if (cacheDirectory.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--cache-size" && argIndex + 1 < argc) {
+			long long value = std::atoll(argv[argIndex + 1]);
+			if (value <= 0) ShowUsage();
+			cacheSize = (uint64_t)value << 20;
+			argIndex += 2;
+		}
+		else break;
 	}
-	else {
-		SourceFilePath = argv[1];
-		OutputFilePath = argv[2];
+	if (printCacheStats) {
+		if (argIndex != argc || cacheDirectory.empty()) ShowUsage();
+		CCompileCache(cacheDirectory, cacheSize).PrintStats(std::cout);
+		return 0;
+	}
+	if ((argc - argIndex) % 2 != 0 || (argIndex == argc && manifestFile.empty())) {
+		ShowUsage();
 	}
 	
-	//LexicalAnalyzerTest();
+	//LexicalAnalyzerTest(argv[argIndex]);
 
-	CLexicalAnalyzer LexicalAnalyzer{ SourceFilePath };
-	LexicalAnalyzer.LexicalAnalyze();
-	auto TerminatorSequence = LexicalAnalyzer.GetTerminatorSequence();
-	CCodeGenerator CodeGenerator{ TerminatorSequence };
-	CodeGenerator.GenerateCode();
-	CodeGenerator.PrintInstructions();	//打印生成的指令
-	CodeGenerator.Output(OutputFilePath);
-}
+	CCompileJob job{ numThreads,printInstructions };
+	if (useCache && !cacheDirectory.empty()) job.SetCache(cacheDirectory, cacheSize);
+	if (writeSymbols) job.EnableSymbols();
+	for (auto& directory : moduleDirectories) {
+		job.AddModuleDirectory(directory);
+	}
+	if (!manifestFile.empty()) {
+		std::string errorMessage;
+		if (!job.ReadManifest(manifestFile, errorMessage)) {
+			std::cerr << "Error: " << errorMessage << std::endl;
+			return 1;
+		}
+	}
+	for (; argIndex < argc; argIndex += 2) {
+		job.AddUnit(argv[argIndex], argv[argIndex + 1]);
+	}
 
+	//每个源文件出错时只报告它自己的错误，其他源文件照常编译
+	job.Run(std::cerr);
+	if (!manifestFile.empty() || job.GetNumUnits() > 1) job.PrintReport(std::cout);
+	return job.AllSucceeded() ? 0 : 1;
+}
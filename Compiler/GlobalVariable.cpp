@@ -1,5 +0,0 @@
-#include "GlobalVariable.h"
-
-std::string SourceFilePath{ "test3.txt" };
-std::string OutputFilePath{ "test.pl0_exe" };
-
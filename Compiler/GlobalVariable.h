@@ -1,6 +0,0 @@
-#pragma once
-#include <string>
-
-extern std::string SourceFilePath;
-extern std::string OutputFilePath;
-
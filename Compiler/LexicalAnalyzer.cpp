@@ -2,7 +2,6 @@
 
 #include <iostream>
 #include <fstream>
-#include "GlobalVariable.h"
 #include "Utils.h"
 
 
@@ -12,10 +11,20 @@ const std::unordered_set<char> StartOfIdentifiers = { '_','a','b','c','d','e','f
 											   'n','o','p','q','r','s','t','u','v','w','x','y','z',
 											   'A','B','C','D','E','F','G','H','I','J','K','L','M',
 											   'N','O','P','Q','R','S','T','U','V','W','X','Y','Z' };
-const std::unordered_set<std::string> Keywords = { "const","var","procedure","call","begin","end","if","then","while","do","odd","print","random"};
-const std::unordered_set<std::string> SpecialSymbols = { ".","=",";",",",":=","<","<=","<>",">",">=","+","-","*","/","(",")" ,"[","]","&","::"};
+const std::unordered_set<std::string> Keywords = { "const","var","procedure","call","begin","end","if","then","while","do","odd","print","random","for","forall","to","step","case","of","else","mod","shl","shr","and","or","xor","min","max","abs","vcopy","vfill","vadd","vsub","vmul","vsum","vdot","new","free","read","readarray","snapshot","module","import"};
+const std::unordered_set<std::string> SpecialSymbols = { ".","=",";",",",":=","<","<=","<>",">",">=","+","-","*","/","(",")" ,"[","]","&","::",":"};
 
 
+//ֳֵֵķΧʱstd::stoiһ׳쳣
+static word_t ParseNumber(const std::string& number)
+{
+#ifdef PL0_64BIT
+	return std::stoll(number);
+#else
+	return std::stoi(number);
+#endif
+}
+
 char CLexicalAnalyzer::GetChar(size_t position)
 {
 	if (position >= 0 && position < FileSize) {
@@ -65,7 +74,8 @@ void CLexicalAnalyzer::LexicalAnalyze()
 					TerminatorSequence.push_back({ currentLine, "::" });
 				}
 				else {
-					Error("Unknown operator: ':', on line " + std::to_string(currentLine));
+					currentPosition += 1;
+					TerminatorSequence.push_back({ currentLine, ":" });
 				}
 			}
 			else if (c == '<') {
@@ -126,7 +136,7 @@ void CLexicalAnalyzer::LexicalAnalyze()
 				number += GetChar(currentPosition);
 				currentPosition += 1;
 			}
-			TerminatorSequence.push_back({ currentLine, "number",std::stoi(number) });
+			TerminatorSequence.push_back({ currentLine, "number",ParseNumber(number) });
 		}
 		//3 ʶ
 		else if (StartOfIdentifiers.contains(c)) {
@@ -171,3 +181,59 @@ bool IsPossibleTerminatorType(const std::string& type)
 	if (SpecialSymbols.contains(type)) return true;
 	return false;
 }
+
+/*
+ֻɨԴļͷmoduleimportհ׺עͣսʱֹͣ
+֮ǰȷԴļǷģԼЩģ飬ҪĴʷĸʽʱ﷨
+*/
+void ScanModuleHeader(const std::string& source, bool& isModule, std::vector<std::string>& imports)
+{
+	isModule = false;
+	imports.clear();
+	size_t position = 0;
+	auto nextWord = [&]() -> std::string {
+		while (position < source.size()) {
+			char c = source[position];
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+				position++;
+			}
+			else if (source.compare(position, 2, "//") == 0) {
+				position = source.find('\n', position);
+				if (position == std::string::npos) position = source.size();
+			}
+			else if (source.compare(position, 2, "/*") == 0) {
+				position = source.find("*/", position + 2);
+				position = position == std::string::npos ? source.size() : position + 2;
+			}
+			else break;
+		}
+		if (position >= source.size()) return {};
+		size_t start = position;
+		if (StartOfIdentifiers.contains(source[position])) {
+			while (position < source.size() && (StartOfIdentifiers.contains(source[position]) || StartOfNumbers.contains(source[position]))) {
+				position++;
+			}
+		}
+		else {
+			position++;
+		}
+		return source.substr(start, position - start);
+	};
+
+	std::string word = nextWord();
+	if (word == "module") {
+		isModule = true;
+		return;
+	}
+	while (word == "import") {
+		while (true) {
+			std::string moduleName = nextWord();
+			if (moduleName.empty() || !StartOfIdentifiers.contains(moduleName[0]) || Keywords.contains(moduleName)) return;
+			imports.push_back(moduleName);
+			word = nextWord();
+			if (word != ",") break;
+		}
+		if (word != ";") return;
+		word = nextWord();
+	}
+}
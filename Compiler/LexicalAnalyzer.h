@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <unordered_set>
+#include "Instruction.h"
 
 
 /*
@@ -12,7 +13,7 @@
 struct STerminator {
 	size_t Line;				// սڵ
 	std::string Type;
-	int32_t NumberValue;		// TypeΪ"number"ʱЧ
+	word_t NumberValue;		// TypeΪ"number"ʱЧ
 	std::string IdentifierName;	// TypeΪ"ident"ʱЧ
 };
 
@@ -34,5 +35,7 @@ public:
 extern const std::unordered_set<std::string> Keywords;
 //﷨̿Եõĺ
 bool IsPossibleTerminatorType(const std::string& type);
+//ɨԴļͷǷģ飨module name;Լεģ飨import a, b;
+void ScanModuleHeader(const std::string& source, bool& isModule, std::vector<std::string>& imports);
 
 
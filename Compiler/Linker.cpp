@@ -0,0 +1,108 @@
+#include "Linker.h"
+#include "CodeGenerator.h"
+#include "Utils.h"
+
+CLinker::CLinker(const SObjectFile& program) : Program(program)
+{
+}
+
+void CLinker::AddModule(std::shared_ptr<const SObjectFile> module)
+{
+	Modules.push_back(std::move(module));
+}
+
+void CLinker::Link()
+{
+	if (Modules.size() != Program.Imports.size()) {
+		Error("Compiler internal error: modules do not match the imports");
+	}
+
+	//Ŀļӳָκϲģзģݵָݵλģʱλ֮
+	Instructions.clear();
+	Addresses.clear();
+	auto append = [&](const SObjectFile& object, word_t relocation) {
+		std::vector<uint32_t>& addresses = Addresses.emplace_back();
+		for (auto& procedure : object.Procedures) {
+			uint32_t address = Instructions.size();
+			addresses.push_back(address);
+			Instructions.insert(Instructions.end(), procedure.Instructions.begin(), procedure.Instructions.end());
+			for (uint32_t offset : procedure.GlobalReferences) {
+				Instructions[address + offset].a += relocation;
+			}
+		}
+	};
+	append(Program, 0);
+	for (size_t i{}; i < Modules.size(); i++) {
+		append(*Modules[i], (word_t)Program.Imports[i].DataAddress - (word_t)CCodeGenerator::DataAddress);
+	}
+
+	ResolveCalls(Program, 0);
+	for (size_t i{}; i < Modules.size(); i++) {
+		ResolveCalls(*Modules[i], i + 1);
+	}
+	BuildSymbols();
+}
+
+void CLinker::BuildSymbols()
+{
+	//ģӳǰģÿĿļǷűеһԴļ
+	Symbols = {};
+	Symbols.NumInstructions = Instructions.size();
+	for (size_t k{}; k <= Modules.size(); k++) {
+		const SObjectFile& object = k == 0 ? Program : *Modules[k - 1];
+		std::string prefix = k == 0 ? "" : object.ModuleName + "::";
+		Symbols.Files.push_back(object.SourceFile);
+		for (size_t i{}; i < object.Procedures.size(); i++) {
+			const SObjectProcedure& procedure = object.Procedures[i];
+			uint32_t address = Addresses[k][i];
+			Symbols.Procedures.push_back({ address,prefix + procedure.Name });
+			for (auto& entry : procedure.Lines) {
+				Symbols.Lines.push_back({ address + entry.Offset,(uint32_t)k,entry.Line });
+			}
+		}
+	}
+}
+
+void CLinker::ResolveCalls(const SObjectFile& object, size_t objectIndex)
+{
+	for (auto& call : object.Calls) {
+		//ҵõӳڵĿļ
+		size_t calledObjectIndex = objectIndex;
+		const SObjectFile* calledObject = &object;
+		uint32_t calledProcedure = call.CalledProcedure;
+		if (calledProcedure == SObjectCall::External) {
+			size_t moduleIndex{};
+			while (moduleIndex < Modules.size() && Program.Imports[moduleIndex].Module != call.Module) moduleIndex++;
+			if (moduleIndex == Modules.size()) {
+				Error("Cannot link procedure '" + call.Name + "': module '" + call.Module + "' is not imported");
+			}
+			calledObjectIndex = moduleIndex + 1;
+			calledObject = Modules[moduleIndex].get();
+			calledProcedure = calledObject->FindExport(call.Name);
+			if (calledProcedure == SObjectFile::NotFound) {
+				Error("Cannot link procedure '" + call.Name + "': module '" + call.Module + "' does not export it");
+			}
+		}
+
+		uint32_t callInstructionAddress = Addresses[objectIndex][call.Procedure] + call.CallInstructionOffset;
+		uint32_t calledProcedureAddress = Addresses[calledObjectIndex][calledProcedure];
+		//FALָֻѭĵַ
+		uint16_t callOpcode = Instructions[callInstructionAddress].F == FAL ? FAL : calledObject->Procedures[calledProcedure].bNeedsStaticLink ? CAL : CAL_v2;
+		Instructions[callInstructionAddress] = { callOpcode,call.LevelDifference,(word_t)calledProcedureAddress };
+	}
+}
+
+const std::vector<Instruction>& CLinker::GetInstructions() const
+{
+	return Instructions;
+}
+
+uint32_t CLinker::GetProcedureAddress(uint32_t index) const
+{
+	return Addresses[0][index];
+}
+
+const SSymbolTable& CLinker::GetSymbols() const
+{
+	return Symbols;
+}
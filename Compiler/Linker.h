@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ObjectFile.h"
+
+/*
+ѳģĿļϲΪһָ
+ĿļӳУӳǰģзģݵָģڳеλ
+CCodeGeneratorԭĻһõӳǷҪ̬ѡCALCAL_v2ַͬʱɷű
+*/
+class CLinker
+{
+private:
+	const SObjectFile& Program;
+	std::vector<std::shared_ptr<const SObjectFile>> Modules;	//Program.ImportsһһӦ
+	std::vector<std::vector<uint32_t>> Addresses;				//ÿĿļиӳڵַǰ
+	std::vector<Instruction> Instructions;
+	SSymbolTable Symbols;
+
+	//ɸӳĵַкűӺķű
+	void BuildSymbols();
+
+	//һĿļеĵָobjectIndexΪAddressesе±
+	void ResolveCalls(const SObjectFile& object, size_t objectIndex);
+
+public:
+	explicit CLinker(const SObjectFile& program);
+	//ӳģ飬˳Program.Importsͬ
+	void AddModule(std::shared_ptr<const SObjectFile> module);
+	//ӣҲõӳʱ
+	void Link();
+
+	const std::vector<Instruction>& GetInstructions() const;
+	//ĵindexӳڵַ
+	uint32_t GetProcedureAddress(uint32_t index) const;
+	const SSymbolTable& GetSymbols() const;
+};
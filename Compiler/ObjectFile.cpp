@@ -0,0 +1,275 @@
+#include "ObjectFile.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+//Ŀļļͷ֮ΪģԴļݡӳ򡢵ָģ
+struct SObjectHeader
+{
+	uint32_t Magic;
+	uint32_t WordSize;						//sizeof(word_t)ʱֳһ
+	uint64_t DataSize;
+	uint64_t NumProcedures;
+	uint64_t NumCalls;
+	uint64_t NumVariables;
+	uint64_t NumImports;
+};
+
+//ֽдֶΣִļͬ
+template<typename T>
+static void WriteValue(std::ostream& out, const T& value)
+{
+	out.write((const char*)&value, sizeof(value));
+}
+
+static void WriteString(std::ostream& out, const std::string& value)
+{
+	WriteValue(out, (uint32_t)value.size());
+	out.write(value.data(), value.size());
+}
+
+//дÿһСֱ
+static void WriteType(std::ostream& out, const SType& type)
+{
+	WriteValue(out, type.Type);
+	if (type.Type == EType::Integer) return;
+	WriteValue(out, type.ArraySize);
+	WriteType(out, *type.InnerType);
+}
+
+//ĿļζȡԽʱ֮Ķȡʧ
+class CObjectReader
+{
+private:
+	const std::string& Content;
+	size_t Position{};
+	bool bFailed{};
+
+public:
+	explicit CObjectReader(const std::string& content) : Content(content) {}
+
+	bool Failed() const { return bFailed; }
+	bool AtEnd() const { return Position == Content.size(); }
+
+	void ReadBytes(void* data, size_t size)
+	{
+		if (bFailed || size > Content.size() - Position) {
+			bFailed = true;
+			return;
+		}
+		std::memcpy(data, Content.data() + Position, size);
+		Position += size;
+	}
+
+	template<typename T>
+	T Read()
+	{
+		T value{};
+		ReadBytes(&value, sizeof(value));
+		return value;
+	}
+
+	std::string ReadString()
+	{
+		uint32_t size = Read<uint32_t>();
+		if (bFailed || size > Content.size() - Position) {
+			bFailed = true;
+			return {};
+		}
+		std::string value = Content.substr(Position, size);
+		Position += size;
+		return value;
+	}
+
+	//Ԫظܳʣֽڷڴ֮ǰų𻵵ļ
+	bool CheckCount(uint64_t count)
+	{
+		if (count > Content.size() - Position) bFailed = true;
+		return !bFailed;
+	}
+
+	SType ReadType()
+	{
+		SType type{ Read<EType>() };
+		if (bFailed || type.Type == EType::Integer) return type;
+		if (type.Type != EType::Array && type.Type != EType::Pointer) {
+			bFailed = true;
+			return type;
+		}
+		type.ArraySize = Read<uint32_t>();
+		type.InnerType = std::make_shared<SType>(ReadType());
+		return type;
+	}
+};
+
+uint32_t SObjectFile::FindExport(const std::string& name) const
+{
+	for (uint32_t i{}; i < Procedures.size(); i++) {
+		if (Procedures[i].Level == 1 && Procedures[i].Name == name) return i;
+	}
+	return NotFound;
+}
+
+const SObjectVariable* SObjectFile::FindVariable(const std::string& name) const
+{
+	for (auto& variable : Variables) {
+		if (variable.Name == name) return &variable;
+	}
+	return nullptr;
+}
+
+void SObjectFile::Write(std::ostream& out) const
+{
+	SObjectHeader header{ ObjectMagic,sizeof(word_t),Data.size(),Procedures.size(),Calls.size(),Variables.size(),Imports.size() };
+	WriteValue(out, header);
+	WriteString(out, ModuleName);
+	WriteString(out, SourceFile);
+	out.write((const char*)Data.data(), Data.size() * sizeof(word_t));
+	for (auto& procedure : Procedures) {
+		WriteString(out, procedure.Name);
+		WriteValue(out, procedure.Level);
+		WriteValue(out, (uint8_t)procedure.bNeedsStaticLink);
+		WriteValue(out, (uint64_t)procedure.Instructions.size());
+		for (auto& instruction : procedure.Instructions) {
+			WriteValue(out, instruction);
+		}
+		WriteValue(out, (uint64_t)procedure.GlobalReferences.size());
+		out.write((const char*)procedure.GlobalReferences.data(), procedure.GlobalReferences.size() * sizeof(uint32_t));
+		WriteValue(out, (uint64_t)procedure.Lines.size());
+		out.write((const char*)procedure.Lines.data(), procedure.Lines.size() * sizeof(SLineEntry));
+	}
+	for (auto& call : Calls) {
+		WriteValue(out, call.Procedure);
+		WriteValue(out, call.CallInstructionOffset);
+		WriteValue(out, call.LevelDifference);
+		WriteValue(out, call.CalledProcedure);
+		WriteString(out, call.Module);
+		WriteString(out, call.Name);
+	}
+	for (auto& variable : Variables) {
+		WriteString(out, variable.Name);
+		WriteType(out, variable.Type);
+		WriteValue(out, variable.Offset);
+		WriteValue(out, (uint8_t)variable.bIsConst);
+	}
+	for (auto& import : Imports) {
+		WriteString(out, import.Module);
+		WriteValue(out, import.DataAddress);
+	}
+}
+
+bool SObjectFile::Read(const std::string& content, std::string& errorMessage)
+{
+	CObjectReader reader(content);
+	SObjectHeader header = reader.Read<SObjectHeader>();
+	if (reader.Failed() || header.Magic != ObjectMagic) {
+		errorMessage = "not an object file";
+		return false;
+	}
+	if (header.WordSize != sizeof(word_t)) {
+		errorMessage = "compiled for " + std::to_string(header.WordSize * 8) + "-bit words, but the compiler uses " + std::to_string(WordBits) + "-bit words";
+		return false;
+	}
+
+	ModuleName = reader.ReadString();
+	SourceFile = reader.ReadString();
+	if (reader.CheckCount(header.DataSize)) {
+		Data.resize(header.DataSize);
+		reader.ReadBytes(Data.data(), Data.size() * sizeof(word_t));
+	}
+	for (uint64_t i{}; i < header.NumProcedures && reader.CheckCount(header.NumProcedures - i); i++) {
+		SObjectProcedure procedure;
+		procedure.Name = reader.ReadString();
+		procedure.Level = reader.Read<int16_t>();
+		procedure.bNeedsStaticLink = reader.Read<uint8_t>();
+		uint64_t numInstructions = reader.Read<uint64_t>();
+		if (!reader.CheckCount(numInstructions)) break;
+		procedure.Instructions.resize(numInstructions);
+		reader.ReadBytes(procedure.Instructions.data(), numInstructions * sizeof(Instruction));
+		uint64_t numReferences = reader.Read<uint64_t>();
+		if (!reader.CheckCount(numReferences)) break;
+		procedure.GlobalReferences.resize(numReferences);
+		reader.ReadBytes(procedure.GlobalReferences.data(), numReferences * sizeof(uint32_t));
+		uint64_t numLines = reader.Read<uint64_t>();
+		if (!reader.CheckCount(numLines)) break;
+		procedure.Lines.resize(numLines);
+		reader.ReadBytes(procedure.Lines.data(), numLines * sizeof(SLineEntry));
+		Procedures.push_back(std::move(procedure));
+	}
+	for (uint64_t i{}; i < header.NumCalls && reader.CheckCount(header.NumCalls - i); i++) {
+		SObjectCall call;
+		call.Procedure = reader.Read<uint32_t>();
+		call.CallInstructionOffset = reader.Read<uint32_t>();
+		call.LevelDifference = reader.Read<int16_t>();
+		call.CalledProcedure = reader.Read<uint32_t>();
+		call.Module = reader.ReadString();
+		call.Name = reader.ReadString();
+		Calls.push_back(std::move(call));
+	}
+	for (uint64_t i{}; i < header.NumVariables && reader.CheckCount(header.NumVariables - i); i++) {
+		SObjectVariable variable;
+		variable.Name = reader.ReadString();
+		variable.Type = reader.ReadType();
+		variable.Offset = reader.Read<uint32_t>();
+		variable.bIsConst = reader.Read<uint8_t>();
+		Variables.push_back(std::move(variable));
+	}
+	for (uint64_t i{}; i < header.NumImports && reader.CheckCount(header.NumImports - i); i++) {
+		SObjectImport import;
+		import.Module = reader.ReadString();
+		import.DataAddress = reader.Read<uint32_t>();
+		Imports.push_back(std::move(import));
+	}
+	if (reader.Failed() || !reader.AtEnd()) {
+		errorMessage = "object file is truncated or corrupted";
+		return false;
+	}
+
+	//ʱֱӰЩ±ƫضλȼǶڷΧ֮
+	for (auto& procedure : Procedures) {
+		for (uint32_t offset : procedure.GlobalReferences) {
+			if (offset >= procedure.Instructions.size()) {
+				errorMessage = "object file is corrupted";
+				return false;
+			}
+		}
+		for (auto& entry : procedure.Lines) {
+			if (entry.Offset >= procedure.Instructions.size()) {
+				errorMessage = "object file is corrupted";
+				return false;
+			}
+		}
+	}
+	for (auto& call : Calls) {
+		if (call.Procedure >= Procedures.size() || call.CallInstructionOffset >= Procedures[call.Procedure].Instructions.size()
+			|| (call.CalledProcedure != SObjectCall::External && call.CalledProcedure >= Procedures.size()))
+		{
+			errorMessage = "object file is corrupted";
+			return false;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<const SObjectFile> LoadModule(const std::string& moduleName, const std::vector<std::filesystem::path>& searchPath,
+	std::string& content, std::string& errorMessage)
+{
+	std::string fileName = moduleName + ObjectExtension;
+	for (auto& directory : searchPath) {
+		std::ifstream file(directory / fileName, std::ios::binary);
+		if (!file.is_open()) continue;
+		content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		auto object = std::make_shared<SObjectFile>();
+		if (!object->Read(content, errorMessage)) {
+			errorMessage = (directory / fileName).string() + ": " + errorMessage;
+			return nullptr;
+		}
+		if (object->ModuleName != moduleName) {
+			errorMessage = (directory / fileName).string() + " is not the object file of module '" + moduleName + "'";
+			return nullptr;
+		}
+		return object;
+	}
+	errorMessage = "cannot find " + fileName;
+	return nullptr;
+}
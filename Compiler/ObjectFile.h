@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Instruction.h"
+#include "Type.h"
+#include "SymbolTable.h"
+
+/*
+ĿļģĽеָûȷյĵַ뵼ĳϲΪִļ
+ģݣģ鼶ıͳʱջ֡ƫ3ʼʱڳջ֡з䣬ʱضλ
+*/
+constexpr uint32_t ObjectMagic = 0x4F304C50;	//"PL0O"
+constexpr const char* ObjectExtension = ".pl0o";
+
+//Ŀļеһӳ
+struct SObjectProcedure
+{
+	std::string Name;						//֣"p1::p2"ӳӳ
+	int16_t Level;
+	bool bNeedsStaticLink;
+	std::vector<Instruction> Instructions;
+	std::vector<uint32_t> GlobalReferences;	//Եַջָ֡ƫSProcedure::GlobalReferences
+	std::vector<SLineEntry> Lines;			//кűSProcedure::Lines
+};
+
+//ȴĵָSCallIntructionӦ
+struct SObjectCall
+{
+	static constexpr uint32_t External = UINT32_MAX;
+
+	uint32_t Procedure;						//ָڵӳĿļе±
+	uint32_t CallInstructionOffset;
+	int16_t LevelDifference;
+	uint32_t CalledProcedure;				//õӳĿļе±꣬ģӳʱΪExternal
+	std::string Module;						//õģӳ
+	std::string Name;
+};
+
+//ģ鼶ıͳĳ"ģ::"
+struct SObjectVariable
+{
+	std::string Name;
+	SType Type;
+	uint32_t Offset;						//ģʱջ֡еƫ
+	bool bIsConst;
+};
+
+//ģ鼰ջ֡еλ
+struct SObjectImport
+{
+	std::string Module;
+	uint32_t DataAddress;
+};
+
+struct SObjectFile
+{
+	std::string ModuleName;					//Ϊʱǳĵһӳ
+	std::string SourceFile;					//Դļ·ڷű
+	std::vector<word_t> Data;				//ģݣݶ
+	std::vector<SObjectProcedure> Procedures;
+	std::vector<SObjectCall> Calls;
+	std::vector<SObjectVariable> Variables;
+	std::vector<SObjectImport> Imports;
+
+	static constexpr uint32_t NotFound = UINT32_MAX;
+
+	//ģ鵼ӳ򣬼Ϊ1ӳ򣬷±ꣻûʱNotFound
+	uint32_t FindExport(const std::string& name) const;
+	//ģ鼶ıûʱnullptr
+	const SObjectVariable* FindVariable(const std::string& name) const;
+
+	void Write(std::ostream& out) const;
+	//Ŀļжȡʽʱfalse
+	bool Read(const std::string& content, std::string& errorMessage);
+};
+
+//searchPathĸĿ¼βҲȡģĿļ"ģ.pl0o"contentΪļ
+//ҲʽʱnullptrerrorMessageΪϢ
+std::shared_ptr<const SObjectFile> LoadModule(const std::string& moduleName, const std::vector<std::filesystem::path>& searchPath,
+	std::string& content, std::string& errorMessage);
@@ -0,0 +1,742 @@
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include "Utils.h"
+
+
+//ҵprocedureڲlevelϵȣprocedure
+static SProcedure* GetAncestor(SProcedure* procedure, int16_t level)
+{
+	while (procedure->Level > level) {
+		procedure = procedure->Parent;
+	}
+	return procedure;
+}
+
+//ǷתָתĿΪָλüa
+static bool IsRelativeJump(uint16_t f)
+{
+	return f == JMP || f == JPC || f == FOR;
+}
+
+//Ƿǰβƫջ֡бָFORָʵǵǰջ֡ƫΪLıڴ
+static bool IsFrameAccess(uint16_t f)
+{
+	return f == LOD || f == LOA || f == STO || f == STO_v2;
+}
+
+//ָԱʽջӰ죺popsֵѹpushesֵ
+//STR_v2ֻջĵַջֵջ
+static void GetStackEffect(const Instruction& instruction, int& pops, int& pushes)
+{
+	pops = 0;
+	pushes = 0;
+	switch (instruction.F) {
+	case LIT:
+	case LOD:
+	case LOA:
+	case LBP:
+	case LDG:
+	case RAN_N:
+	case RAN:
+	case RED:
+		pushes = 1;
+		break;
+	case STO:
+	case FRE:
+	case JPC:
+	case JTB:
+	case WRT:
+	case STR_v2:
+	case POP:
+		pops = 1;
+		break;
+	case STR:
+	case FAL:	//FALָֵֵ
+		pops = 2;
+		break;
+	case FOR:	//FORָѭʱֵֵͲ
+		pops = 3;
+		break;
+	case LOR:
+	case NEW:
+		pops = 1;
+		pushes = 1;
+		break;
+	case RDA:
+		pops = 2;
+		pushes = 1;
+		break;
+	case OPR:
+		pops = (instruction.a == Neg || instruction.a == Odd || instruction.a == Abs) ? 1 : 2;
+		pushes = 1;
+		break;
+	case VEC:
+		pops = (instruction.L == VecSum) ? 1 : (instruction.L == VecAdd || instruction.L == VecSub || instruction.L == VecMul) ? 3 : 2;
+		pushes = (instruction.L == VecSum || instruction.L == VecDot) ? 1 : 0;
+		break;
+	default:
+		break;
+	}
+}
+
+//VECָǷдڴ棻vsumvdotֻڴ
+static bool IsVectorStore(const Instruction& instruction)
+{
+	return instruction.L != VecSum && instruction.L != VecDot;
+}
+
+//instructions[i]ǷֱӸֵSTR/STR_v2ջĵַǡǰһLOAָõ
+static bool IsDirectStore(const std::vector<Instruction>& instructions, uint32_t i)
+{
+	return (instructions[i].F == STR || instructions[i].F == STR_v2) && i > 0 && instructions[i - 1].F == LOA;
+}
+
+//ģִʱջеһֵָ[Start, End]õ
+struct SStackValue {
+	int32_t Start;					//-1ʾֵһָõ
+	int32_t End;
+	bool bInvariant;				//ѭ᣺Ƿѭı
+	uint32_t ValueNumber{};			//ڹӱʽɾֵֵͬһ
+};
+
+//ģջȡiָpopsѹջ˳򷵻أջвĲ֮ǰѹδֵ֪
+//Щɽŵiָ֮ǰָõisContiguousΪtruestartΪһ
+static std::vector<SStackValue> PopOperands(std::vector<SStackValue>& stack, int pops, uint32_t i, int32_t& start, bool& isContiguous)
+{
+	std::vector<SStackValue> operands(pops, SStackValue{ -1,-1,false });
+	for (int k = pops - 1; k >= 0 && !stack.empty(); k--) {
+		operands[k] = stack.back();
+		stack.pop_back();
+	}
+
+	start = i;
+	isContiguous = true;
+	for (int k = pops - 1; k >= 0; k--) {
+		if (operands[k].Start < 0 || operands[k].End != start - 1) {
+			isContiguous = false;
+			break;
+		}
+		start = operands[k].Start;
+	}
+	return operands;
+}
+
+//OPRָǷûиҲԱǰִ
+static bool IsSafeOperator(word_t opr)
+{
+	return opr != Div && opr != Mod;
+}
+
+//OPRָǷ㽻
+static bool IsCommutativeOperator(word_t opr)
+{
+	return opr == Add || opr == Mul || opr == Equal || opr == NotEqual || opr == And || opr == Or || opr == Xor || opr == Min || opr == Max;
+}
+
+//valueǷ2ݣ򷵻ָ򷵻-1
+static int32_t GetPowerOfTwo(word_t value)
+{
+	if (value < 2 || (value & (value - 1)) != 0) return -1;
+	int32_t exponent{};
+	while (value > 1) {
+		value >>= 1;
+		exponent++;
+	}
+	return exponent;
+}
+
+COptimizer::COptimizer(std::vector<std::shared_ptr<SProcedure>>& procedures, std::vector<SCallIntruction>& callInstructions)
+	: Procedures(procedures), CallInstructions(callInstructions)
+{
+}
+
+bool COptimizer::MarkStaticLinkPath(SProcedure* procedure, int16_t targetLevel)
+{
+	bool changed{};
+	while (procedure && procedure->Level > targetLevel) {
+		if (!procedure->bNeedsStaticLink) {
+			procedure->bNeedsStaticLink = true;
+			changed = true;
+		}
+		procedure = procedure->Parent;
+	}
+	return changed;
+}
+
+uint32_t COptimizer::AllocateTemporary(SProcedure& procedure)
+{
+	procedure.NumTemporaries++;
+	return procedure.StackOffset++;
+}
+
+void COptimizer::Rebuild(SProcedure& procedure, const std::vector<SInstructionSlot>& slots)
+{
+	const std::vector<Instruction>& oldInstructions = procedure.Instructions;
+	std::vector<Instruction> newInstructions;
+	//ָiӦλãentryPositionΪPreheaderĿͷbodyPositionΪReplacementĿͷnewPositionΪָi
+	std::vector<uint32_t> entryPosition(oldInstructions.size() + 1);
+	std::vector<uint32_t> bodyPosition(oldInstructions.size() + 1);
+	std::vector<uint32_t> newPosition(oldInstructions.size());
+
+	for (uint32_t i{}; i < oldInstructions.size(); i++) {
+		const SInstructionSlot& slot = slots[i];
+		entryPosition[i] = newInstructions.size();
+		newInstructions.insert(newInstructions.end(), slot.Preheader.begin(), slot.Preheader.end());
+		bodyPosition[i] = newInstructions.size();
+		newInstructions.insert(newInstructions.end(), slot.Replacement.begin(), slot.Replacement.end());
+		newPosition[i] = newInstructions.size();
+		if (!slot.bRemoved) newInstructions.push_back(oldInstructions[i]);
+		newInstructions.insert(newInstructions.end(), slot.After.begin(), slot.After.end());
+	}
+	entryPosition[oldInstructions.size()] = bodyPosition[oldInstructions.size()] = newInstructions.size();
+
+	//ת
+	for (uint32_t i{}; i < oldInstructions.size(); i++) {
+		if (slots[i].bRemoved || !IsRelativeJump(oldInstructions[i].F)) continue;
+		uint32_t target = i + oldInstructions[i].a;
+		bool fromInsideLoop = target < oldInstructions.size() && !slots[target].Preheader.empty() && i >= target && i <= slots[target].LoopEnd;
+		uint32_t newTarget = fromInsideLoop ? bodyPosition[target] : entryPosition[target];
+		newInstructions[newPosition[i]].a = (word_t)newTarget - (word_t)newPosition[i];
+	}
+	//ȴCALָλ
+	for (auto& callInstruction : CallInstructions) {
+		if (callInstruction.Procedure == &procedure) {
+			callInstruction.CallInstructionOffset = newPosition[callInstruction.CallInstructionOffset];
+		}
+	}
+	//кűһָ֮ǰĴڵУһеָȫɾȥһ
+	std::vector<SLineEntry> lines;
+	for (auto& entry : procedure.Lines) {
+		uint32_t offset = entryPosition[entry.Offset];
+		if (!lines.empty() && lines.back().Offset == offset) lines.pop_back();
+		if (lines.empty() || lines.back().Line != entry.Line) lines.push_back({ offset,entry.Line });
+	}
+	if (!lines.empty() && lines.back().Offset == newInstructions.size()) lines.pop_back();
+	procedure.Lines = std::move(lines);
+	procedure.StatementOffset = entryPosition[procedure.StatementOffset];
+	procedure.Instructions = std::move(newInstructions);
+}
+
+void COptimizer::FindAddressTakenVariables()
+{
+	AddressTakenVariables.clear();
+	for (auto& procedure : Procedures) {
+		const std::vector<Instruction>& instructions = procedure->Instructions;
+		for (uint32_t i{}; i < instructions.size(); i++) {
+			if (instructions[i].F != LOA) continue;
+			//Ŵ洢ĵַֻڸñֵᱻ
+			if (i + 1 < instructions.size() && IsDirectStore(instructions, i + 1)) continue;
+			AddressTakenVariables.insert({ GetAncestor(procedure.get(), procedure->Level + instructions[i].L), instructions[i].a });
+		}
+	}
+}
+
+bool COptimizer::IsAddressTaken(SProcedure& procedure, int16_t levelDiff, int32_t offset)
+{
+	return AddressTakenVariables.contains({ GetAncestor(&procedure, procedure.Level + levelDiff), offset });
+}
+
+bool COptimizer::EliminateCommonSubexpressions(SProcedure& procedure, uint32_t blockStart, uint32_t blockEnd, std::vector<SInstructionSlot>& slots, std::vector<uint32_t>& temporaries)
+{
+	const std::vector<Instruction>& instructions = procedure.Instructions;
+
+	//ֵţԣ룬ֵţȡڴİ汾Ϊֵͬһȣֵ0δֵ֪
+	std::map<std::vector<int64_t>, uint32_t> valueNumbers;
+	uint32_t nextValueNumber{ 1 };
+	//ڴİ汾ÿδ洢һʹô洢ǰĶȡõֵͬ
+	std::map<std::pair<int16_t, int32_t>, uint32_t> variableVersions;	//ֱӸֵı
+	uint32_t indirectVersion{};		//ָͨĴ洢޸Ԫغͱȡַı
+	uint32_t callVersion{};			//ӳõȣ޸κα
+	auto storeVariable = [&](int16_t levelDiff, int32_t offset) {
+		variableVersions[{ levelDiff,offset }]++;
+		if (IsAddressTaken(procedure, levelDiff, offset)) indirectVersion++;
+	};
+
+	struct SOccurrence {
+		uint32_t Start;
+		uint32_t End;
+	};
+	std::map<uint32_t, std::vector<SOccurrence>> occurrences;	//ÿֵųֵλãֵ˳
+	std::vector<SStackValue> stack;
+
+	for (uint32_t i = blockStart; i <= blockEnd; i++) {
+		const Instruction& instruction = instructions[i];
+		int pops, pushes;
+		GetStackEffect(instruction, pops, pushes);
+
+		int32_t start;
+		bool isContiguous;
+		std::vector<SStackValue> operands = PopOperands(stack, pops, i, start, isContiguous);
+
+		switch (instruction.F) {
+		case LIT:
+		case LOD:
+		case LOA:
+		case LBP:
+		case LDG:
+		case RAN_N:
+		case RAN:
+		case RED:
+		case JMP:
+		case JPC:
+		case JTB:
+		case OPR:
+		case LOR:
+		case WRT:
+		case POP:
+			break;
+		case STO:
+		case STO_v2:
+			storeVariable(instruction.L, instruction.a);
+			break;
+		case FOR:
+			storeVariable(0, instruction.L);
+			break;
+		case STR:
+		case STR_v2:
+			if (IsDirectStore(instructions, i)) storeVariable(instructions[i - 1].L, instructions[i - 1].a);
+			else indirectVersion++;
+			break;
+		case VEC:
+			if (IsVectorStore(instruction)) indirectVersion++;
+			break;
+		case RDA:
+			indirectVersion++;
+			break;
+		default:
+			callVersion++;
+			break;
+		}
+		if (pushes == 0) continue;
+
+		std::vector<int64_t> key{ instruction.F };
+		bool isKnown = true;
+		for (auto& operand : operands) {
+			isKnown = isKnown && operand.ValueNumber != 0;
+		}
+		switch (instruction.F) {
+		case LIT:
+		case LOA:
+		case LBP:
+			key.insert(key.end(), { instruction.L,instruction.a });
+			break;
+		case LOD:
+			key.insert(key.end(), { instruction.L,instruction.a,variableVersions[{ instruction.L,instruction.a }],callVersion });
+			if (IsAddressTaken(procedure, instruction.L, instruction.a)) key.push_back(indirectVersion);
+			break;
+		case LOR:
+			key.insert(key.end(), { operands[0].ValueNumber,indirectVersion,callVersion });
+			break;
+		case OPR:
+			key.push_back(instruction.a);
+			for (auto& operand : operands) {
+				key.push_back(operand.ValueNumber);
+			}
+			//㽻ɵ㣬˳Ӱ
+			if (operands.size() == 2 && IsCommutativeOperator(instruction.a)) {
+				std::sort(key.end() - 2, key.end());
+			}
+			break;
+		default:
+			isKnown = false;
+			break;
+		}
+
+		uint32_t valueNumber = nextValueNumber;
+		if (isKnown) {
+			valueNumber = valueNumbers.insert({ key,nextValueNumber }).first->second;
+		}
+		if (valueNumber == nextValueNumber) nextValueNumber++;
+
+		stack.push_back({ isContiguous ? start : -1,(int32_t)i,false,valueNumber });
+		if (isKnown && isContiguous && (int32_t)i > start) {
+			occurrences[valueNumber].push_back({ (uint32_t)start,i });
+		}
+	}
+
+	//䳤ȴӴС滻еֵҪټ
+	std::vector<std::pair<uint32_t, uint32_t>> candidates;	//䳤ȣֵţ
+	for (auto& [valueNumber, list] : occurrences) {
+		if (list.size() >= 2) candidates.push_back({ list[0].End - list[0].Start + 1,valueNumber });
+	}
+	std::sort(candidates.begin(), candidates.end(), std::greater<>{});
+
+	uint32_t numTemporaries{};
+	for (auto& [length, valueNumber] : candidates) {
+		std::vector<SOccurrence> list;
+		for (auto& occurrence : occurrences[valueNumber]) {
+			if (!slots[occurrence.Start].bRemoved) list.push_back(occurrence);
+		}
+		//һμʱһSTO_v2֮ÿlength-1ָ
+		if (list.size() < 2 || (length - 1) * (list.size() - 1) <= 1) continue;
+
+		if (numTemporaries == temporaries.size()) temporaries.push_back(AllocateTemporary(procedure));
+		uint32_t temporary = temporaries[numTemporaries++];
+		slots[list[0].End].After.push_back({ STO_v2,0,(word_t)temporary });
+		for (uint32_t k = 1; k < list.size(); k++) {
+			slots[list[k].Start].Replacement.push_back({ LOD,0,(word_t)temporary });
+			for (uint32_t i = list[k].Start; i <= list[k].End; i++) {
+				slots[i].bRemoved = true;
+			}
+		}
+	}
+	return numTemporaries > 0;
+}
+
+void COptimizer::ReduceStrength()
+{
+	for (auto& procedure : Procedures) {
+		std::vector<Instruction>& instructions = procedure->Instructions;
+		std::vector<SInstructionSlot> slots(instructions.size());
+		bool changed{};
+
+		//ڶǳ㣺LIT c; OPR op
+		for (uint32_t i{}; i + 1 < instructions.size(); i++) {
+			if (instructions[i].F != LIT || instructions[i + 1].F != OPR) continue;
+			word_t constant = instructions[i].a;
+			word_t opr = instructions[i + 1].a;
+
+			bool isIdentity = (constant == 1 && (opr == Mul || opr == Div))
+				|| (constant == 0 && (opr == Add || opr == Sub || opr == Or || opr == Xor || opr == Shl || opr == Shr));
+			if (isIdentity) {
+				//x*1x/1x+0ȣֱɾָ
+				slots[i].bRemoved = slots[i + 1].bRemoved = true;
+				changed = true;
+				i++;
+				continue;
+			}
+
+			int32_t exponent = GetPowerOfTwo(constant);
+			if (exponent > 0 && opr == Mul) {
+				instructions[i].a = exponent;
+				instructions[i + 1].a = Shl;
+			}
+			else if (exponent > 0 && opr == Div) {
+				instructions[i].a = exponent;
+				instructions[i + 1].a = DivPow2;
+			}
+		}
+		if (changed) Rebuild(*procedure, slots);
+	}
+}
+
+void COptimizer::EliminateCommonSubexpressions()
+{
+	FindAddressTakenVariables();
+
+	for (auto& procedure : Procedures) {
+		const std::vector<Instruction>& instructions = procedure->Instructions;
+
+		//Ŀͷ䲿ֵĿͷתĿꡢתָָ֮
+		std::vector<bool> isLeader(instructions.size() + 1);
+		isLeader[procedure->StatementOffset] = true;
+		for (uint32_t i{}; i < instructions.size(); i++) {
+			if (!IsRelativeJump(instructions[i].F)) continue;
+			isLeader[i + 1] = true;
+			isLeader[i + instructions[i].a] = true;
+		}
+
+		std::vector<SInstructionSlot> slots(instructions.size());
+		std::vector<uint32_t> temporaries;
+		bool changed{};
+		uint32_t blockStart = procedure->StatementOffset;
+		for (uint32_t i = blockStart + 1; i <= instructions.size(); i++) {
+			if (i == instructions.size() || isLeader[i]) {
+				changed = EliminateCommonSubexpressions(*procedure, blockStart, i - 1, slots, temporaries) || changed;
+				blockStart = i;
+			}
+		}
+		if (changed) Rebuild(*procedure, slots);
+	}
+}
+
+void COptimizer::HoistLoopInvariants(SProcedure& procedure, uint32_t loopStart, uint32_t loopEnd)
+{
+	const std::vector<Instruction>& instructions = procedure.Instructions;
+
+	//forѭɽѭ֮ǰJMPĩβFORָ룬ѭǰôJMP֮ǰ
+	uint32_t entry = loopStart;
+	if (instructions[loopEnd].F == FOR) {
+		entry = loopStart - 1;
+		if (instructions[entry].F != JMP || entry + instructions[entry].a != loopEnd) return;
+	}
+
+	//ѭֻܴentry룬
+	for (uint32_t i{}; i < instructions.size(); i++) {
+		if (!IsRelativeJump(instructions[i].F) || i == entry) continue;
+		uint32_t target = i + instructions[i].a;
+		bool isInsideLoop = i >= loopStart && i <= loopEnd;
+		if (!isInsideLoop && target > loopStart && target <= loopEnd) return;
+	}
+
+	//ͳѭеĴ洢ָͨĴ洢޸καȡַıӳÿ޸κα
+	std::set<std::pair<int16_t, int32_t>> storedVariables;
+	bool hasIndirectStore{};
+	bool hasCall{};
+	for (uint32_t i = loopStart; i <= loopEnd; i++) {
+		const Instruction& instruction = instructions[i];
+		switch (instruction.F) {
+		case LIT:
+		case LOD:
+		case LOA:
+		case LBP:
+		case LDG:
+		case RAN_N:
+		case RAN:
+		case RED:
+		case JMP:
+		case JPC:
+		case JTB:
+		case OPR:
+		case LOR:
+		case WRT:
+		case POP:
+			break;
+		case STO:
+		case STO_v2:
+			storedVariables.insert({ instruction.L,instruction.a });
+			break;
+		case FOR:
+			storedVariables.insert({ 0,instruction.L });
+			break;
+		case STR:
+		case STR_v2:
+			if (IsDirectStore(instructions, i)) storedVariables.insert({ instructions[i - 1].L,instructions[i - 1].a });
+			else hasIndirectStore = true;
+			break;
+		case VEC:
+			if (IsVectorStore(instruction)) hasIndirectStore = true;
+			break;
+		case RDA:
+			hasIndirectStore = true;
+			break;
+		default:
+			hasCall = true;
+			break;
+		}
+	}
+
+	//ģִѭеָҳһָõҲѭıֵ
+	std::vector<SStackValue> stack;
+	std::vector<std::pair<uint32_t, uint32_t>> invariantRanges;
+	for (uint32_t i = loopStart; i <= loopEnd; i++) {
+		const Instruction& instruction = instructions[i];
+		int pops, pushes;
+		GetStackEffect(instruction, pops, pushes);
+
+		int32_t start;
+		bool isContiguous;
+		std::vector<SStackValue> operands = PopOperands(stack, pops, i, start, isContiguous);
+		bool operandsInvariant = true;
+		for (auto& operand : operands) {
+			operandsInvariant = operandsInvariant && operand.bInvariant;
+		}
+		if (instruction.F == STR_v2) {
+			//洢ֵȻջУѾٽָ֮
+			if (!stack.empty()) stack.back() = { -1,-1,false };
+			continue;
+		}
+		if (pushes == 0) continue;
+
+		bool isInvariant{};
+		switch (instruction.F) {
+		case LIT:
+		case LOA:
+		case LBP:
+			isInvariant = true;
+			break;
+		case LOD:
+			isInvariant = !hasCall && !storedVariables.contains({ instruction.L,instruction.a })
+				&& !(hasIndirectStore && IsAddressTaken(procedure, instruction.L, instruction.a));
+			break;
+		case OPR:
+			isInvariant = isContiguous && operandsInvariant && IsSafeOperator(instruction.a);
+			break;
+		default:
+			break;
+		}
+		stack.push_back({ isContiguous ? start : -1,(int32_t)i,isInvariant });
+		if (isInvariant && (int32_t)i > start) {
+			invariantRanges.push_back({ (uint32_t)start,i });
+		}
+	}
+	if (invariantRanges.empty()) return;
+
+	//ֻĲָͬмֵͬһʱ
+	std::sort(invariantRanges.begin(), invariantRanges.end(), [](const auto& a, const auto& b) {
+		return a.first != b.first ? a.first < b.first : a.second > b.second;
+		});
+	std::vector<SInstructionSlot> slots(instructions.size());
+	std::map<std::vector<std::tuple<uint16_t, int16_t, word_t>>, uint32_t> temporaries;
+	int64_t lastEnd = -1;
+	for (auto& [start, end] : invariantRanges) {
+		if ((int64_t)start <= lastEnd) continue;
+		lastEnd = end;
+
+		std::vector<std::tuple<uint16_t, int16_t, word_t>> key;
+		for (uint32_t i = start; i <= end; i++) {
+			key.push_back({ instructions[i].F,instructions[i].L,instructions[i].a });
+		}
+		auto it = temporaries.find(key);
+		if (it == temporaries.end()) {
+			uint32_t temporary = AllocateTemporary(procedure);
+			it = temporaries.insert({ key,temporary }).first;
+			auto& preheader = slots[entry].Preheader;
+			preheader.insert(preheader.end(), instructions.begin() + start, instructions.begin() + end + 1);
+			preheader.push_back({ STO,0,(word_t)temporary });
+		}
+
+		slots[start].Replacement.push_back({ LOD,0,(word_t)it->second });
+		for (uint32_t i = start; i <= end; i++) {
+			slots[i].bRemoved = true;
+		}
+	}
+	slots[entry].LoopEnd = loopEnd;
+	Rebuild(procedure, slots);
+}
+
+void COptimizer::HoistLoopInvariants()
+{
+	FindAddressTakenVariables();
+
+	for (auto& procedure : Procedures) {
+		//ÿתJMPFORӦһѭѭĳȴСȴڲѭ
+		//᲻ӻɾתָõڼתָʶһѭ
+		std::vector<std::pair<uint32_t, uint32_t>> loops;	//ѭȣţ
+		for (uint32_t i{}; i < procedure->Instructions.size(); i++) {
+			const Instruction& instruction = procedure->Instructions[i];
+			if ((instruction.F == JMP || instruction.F == FOR) && instruction.a <= 0) {
+				loops.push_back({ (uint32_t)-instruction.a,loops.size() });
+			}
+		}
+		std::sort(loops.begin(), loops.end());
+
+		for (auto& [length, ordinal] : loops) {
+			uint32_t count{};
+			for (uint32_t i{}; i < procedure->Instructions.size(); i++) {
+				const Instruction& instruction = procedure->Instructions[i];
+				if ((instruction.F == JMP || instruction.F == FOR) && instruction.a <= 0 && count++ == ordinal) {
+					HoistLoopInvariants(*procedure, i + instruction.a, i);
+					break;
+				}
+			}
+		}
+	}
+}
+
+void COptimizer::ReserveTemporaries()
+{
+	for (auto& procedure : Procedures) {
+		if (procedure->NumTemporaries == 0) continue;
+
+		//䲿תͷָӦٴηռ
+		std::vector<SInstructionSlot> slots(procedure->Instructions.size());
+		slots[procedure->StatementOffset].Preheader.push_back({ INT,0,(word_t)procedure->NumTemporaries });
+		slots[procedure->StatementOffset].LoopEnd = procedure->Instructions.size() - 1;
+		Rebuild(*procedure, slots);
+	}
+}
+
+void COptimizer::EliminateStaticLinks()
+{
+	//ջ֡ͷֲ䣬DLSLΪ0RAΪ׷ӵHLTָĵַ
+	for (auto& procedure : Procedures) {
+		procedure->bNeedsStaticLink = procedure->Level == 0 || procedure->bIsForallBody;	//ΪforallѭѹSL
+	}
+
+	/*
+	һӳҪ̬ҽǶڲӳҪž̬ջ֡ȥʸģģջ֡
+	ջ֡Ǵ0ʼ˷ıҪ̬
+	*/
+	//1. 
+	for (auto& procedure : Procedures) {
+		for (auto& instruction : procedure->Instructions) {
+			if (!IsFrameAccess(instruction.F)) continue;
+			if (instruction.L >= 0) continue;
+
+			int16_t targetLevel = procedure->Level + instruction.L;
+			//LODLOAʱᱻΪԵַSTOSTO_v2Ȼž̬
+			if (targetLevel > 0 || instruction.F == STO || instruction.F == STO_v2) {
+				MarkStaticLinkPath(procedure.get(), targetLevel);
+			}
+		}
+	}
+	//2. ӳãҪ̬ӳʱҪŵߵľ̬ҵߵĸ򣻷ֱٱ仯
+	bool changed{ true };
+	while (changed) {
+		changed = false;
+		for (auto& callInstruction : CallInstructions) {
+			SProcedure* calledProcedure = callInstruction.CalledProcedure;
+			if (!calledProcedure->bNeedsStaticLink) continue;
+			if (callInstruction.LevelDifference == 1) continue;	//ӳʱSLǵߵBasePointer
+
+			if (MarkStaticLinkPath(callInstruction.Procedure, calledProcedure->Level - 1)) {
+				changed = true;
+			}
+		}
+	}
+
+	//3. ޸ָıΪԵַʣҪ̬ջ֡еƫ1
+	//ͬʱ¼ӳзջָ֡ģӵʱЩָеƫҪģݵλ
+	for (auto& procedure : Procedures) {
+		procedure->GlobalReferences.clear();
+		for (uint32_t i{}; i < procedure->Instructions.size(); i++) {
+			Instruction& instruction = procedure->Instructions[i];
+			if (!IsFrameAccess(instruction.F)) continue;
+
+			int16_t targetLevel = procedure->Level + instruction.L;
+			if (targetLevel == 0 && procedure->Level > 0) {
+				procedure->GlobalReferences.push_back(i);
+			}
+			if (targetLevel == 0 && instruction.F == LOD) {
+				instruction = { LDG,0,instruction.a };
+			}
+			else if (targetLevel == 0 && instruction.F == LOA) {
+				instruction = { LIT,0,instruction.a };
+			}
+			else if (!GetAncestor(procedure.get(), targetLevel)->bNeedsStaticLink) {
+				instruction.a -= 1;
+			}
+		}
+	}
+	for (auto& procedure : Procedures) {
+		if (procedure->bNeedsStaticLink) continue;
+		for (auto& instruction : procedure->Instructions) {
+			if (instruction.F == FOR) instruction.L -= 1;
+		}
+		procedure->StackOffset -= 1;
+		for (auto& variable : procedure->Variables) {
+			variable.Offset -= 1;
+		}
+	}
+}
+
+void COptimizer::BuildDataSegment(std::vector<word_t>& data)
+{
+	SProcedure& main = *Procedures[0];
+	std::vector<SInstructionSlot> slots(main.Instructions.size());
+
+	//䲿֮ǰֻΪѹֵLITΪռINTReserveTemporaries䲿ֿͷINTҲһת
+	uint32_t end = main.StatementOffset;
+	if (main.NumTemporaries && main.Instructions[end].F == INT && main.Instructions[end].a == (word_t)main.NumTemporaries) {
+		end++;
+	}
+	data.clear();
+	for (uint32_t i{}; i < end; i++) {
+		const Instruction& instruction = main.Instructions[i];
+		if (instruction.F == LIT) {
+			data.push_back(instruction.a);
+		}
+		else if (instruction.F == INT) {
+			data.insert(data.end(), instruction.a, 0);
+		}
+		else {
+			Error("Compiler internal error: unexpected instruction before the statements of main");
+		}
+		slots[i].bRemoved = true;
+	}
+	Rebuild(main, slots);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <set>
+#include <utility>
+#include "CodeGenerator.h"
+
+//ؽָʱָеһָӦ޸
+struct SInstructionSlot {
+	std::vector<Instruction> Preheader;		//ڸָ֮ǰѭǰô룬ѭתָʱִЩ
+	uint32_t LoopEnd{};						//Preheaderѭһָ[ָ, LoopEnd]תʱPreheader
+	std::vector<Instruction> Replacement;	//ڸָ֮ǰתָʱִЩ
+	bool bRemoved{};						//Ƿɾָ
+	std::vector<Instruction> After;			//ڸָ֮
+};
+
+//﷨֮󡢺ϲָ֮ǰԸӳָнŻ
+class COptimizer
+{
+private:
+	std::vector<std::shared_ptr<SProcedure>>& Procedures;
+	std::vector<SCallIntruction>& CallInstructions;
+
+	std::set<std::pair<SProcedure*, int32_t>> AddressTakenVariables;	//LOAȡַıԣջ֡ӳƫʾ
+
+	//procedureĸϣδtargetLevelӳ򶼱ΪҪ̬Ƿµı
+	bool MarkStaticLinkPath(SProcedure* procedure, int16_t targetLevel);
+	//procedureջ֡зһʱƫ
+	uint32_t AllocateTemporary(SProcedure& procedure);
+	//slotsе޸ؽprocedureָУͬʱתCALλáкűStatementOffset
+	void Rebuild(SProcedure& procedure, const std::vector<SInstructionSlot>& slots);
+	//ҳбȡַıAddressTakenVariables
+	void FindAddressTakenVariables();
+	//procedureеָLOD/STO levelDiff offsetʵıǷȡַ
+	bool IsAddressTaken(SProcedure& procedure, int16_t levelDiff, int32_t offset);
+	//Ի[blockStart, blockEnd]оֲֵţ޸ļ¼slotsУtemporariesǿԸõʱǷ޸
+	bool EliminateCommonSubexpressions(SProcedure& procedure, uint32_t blockStart, uint32_t blockEnd, std::vector<SInstructionSlot>& slots, std::vector<uint32_t>& temporaries);
+	//ѭ[loopStart, loopEnd]еѭᵽѭ֮ǰloopEndloopStartJMPFORָ
+	void HoistLoopInvariants(SProcedure& procedure, uint32_t loopStart, uint32_t loopEnd);
+
+public:
+	COptimizer(std::vector<std::shared_ptr<SProcedure>>& procedures, std::vector<SCallIntruction>& callInstructions);
+
+	//ǿɾ10㣬ˡ2ݸΪλ
+	void ReduceStrength();
+	//ӱʽɾÿڣһμĳֵʱ䱣浽ʱУ֮ٴμֵʱֱӶȡʱ
+	void EliminateCommonSubexpressions();
+	//ѭ᣺ÿwhileѭforѭвѭıļŵѭ֮ǰʱ
+	void HoistLoopInvariants();
+	//䲿ֵĿͷΪŻʱʱԤջռ䣬ӦõʱŻ֮
+	void ReserveTemporaries();
+	//̼ҳ㣨ջ֡ӳȥǵľ̬
+	//ıΪԵַʣҪ̬ӳջ֡ͷֻDLRAֲƫ1
+	void EliminateStaticLinks();
+	//ΪʱռָתΪݶΣɽڼʱֱӷջУӦ
+	//dataջ֡дƫ3ʼĳʼֵ
+	void BuildDataSegment(std::vector<word_t>& data);
+};
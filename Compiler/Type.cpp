@@ -23,6 +23,12 @@ uint32_t GetSize(const SType& type)
 	else return 0;
 }
 
+const SType& GetElementType(const SType& type)
+{
+	if (type.Type == EType::Array) return GetElementType(*type.InnerType);
+	else return type;
+}
+
 SType BuildMultiLevelPointerType(uint32_t level, const SType& innerType)
 {
 	if (level == 0) return innerType;
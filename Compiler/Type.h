@@ -20,6 +20,8 @@ struct SType {
 };
 
 uint32_t GetSize(const SType& type);
+//άڲԪصͣʱtype
+const SType& GetElementType(const SType& type);
 //һ༶ָͣlevelָļ
 //levelΪ0ʱinnerType
 SType BuildMultiLevelPointerType(uint32_t level, const SType& innerType);
@@ -1,9 +1,6 @@
 #include "Utils.h"
-#include <iostream>
 
 void Error(const std::string& message)
 {
-	std::cerr <<"Error: " << message << std::endl;
-	//throw std::exception{};	//debugʱ׳Է㶨λλ
-	exit(1);
+	throw CCompileError{ message };
 }
@@ -1,5 +1,13 @@
 #pragma once
+#include <stdexcept>
 #include <string>
 
-void Error(const std::string& message);
+//messageΪϢһԴļӰͬʱԴļ
+class CCompileError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
 
+//׳CCompileError᷵
+[[noreturn]] void Error(const std::string& message);
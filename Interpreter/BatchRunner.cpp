@@ -0,0 +1,238 @@
+#include "BatchRunner.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+#include "WorkStealingPool.h"
+#include "Scheduler.h"
+
+CBatchRunner::CBatchRunner(uint32_t numThreads, uword_t maxStackSize, EOutputFormat outputFormat)
+	: NumThreads(std::max<uint32_t>(numThreads, 1)), MaxStackSize(maxStackSize), OutputFormat(outputFormat)
+{
+}
+
+bool CBatchRunner::ReadManifest(const std::string& manifestFile, std::string& errorMessage)
+{
+	std::ifstream file(manifestFile);
+	if (!file.is_open()) {
+		errorMessage = "Cannot open manifest: " + manifestFile;
+		return false;
+	}
+
+	std::string line;
+	for (size_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+		std::istringstream fields(line);
+		SBatchRun run{};
+		if (!(fields >> run.Executable) || run.Executable[0] == '#') continue;
+
+		std::string seed;
+		if (fields >> seed) {
+			size_t end{};
+			try {
+				run.Seed = std::stoull(seed, &end);
+			}
+			catch (const std::exception&) {
+				end = 0;
+			}
+			if (end != seed.size() || seed[0] == '-') {
+				errorMessage = manifestFile + ":" + std::to_string(lineNumber) + ": invalid seed: " + seed;
+				return false;
+			}
+			run.bHasSeed = true;
+		}
+		fields >> run.InputFile;
+		std::string extra;
+		if (fields >> extra) {
+			errorMessage = manifestFile + ":" + std::to_string(lineNumber) + ": unexpected field: " + extra;
+			return false;
+		}
+		Runs.push_back(std::move(run));
+	}
+
+	//ÿִļֻȡһΣйýĳ򣻲ܶȡļʱ
+	std::map<std::string, std::pair<std::shared_ptr<const SProgram>, std::string>> programs;
+	for (auto& run : Runs) {
+		auto it = programs.find(run.Executable);
+		if (it == programs.end()) {
+			std::string loadError;
+			std::shared_ptr<const SProgram> program = Pl0VirtualMachine::ReadProgram(run.Executable, loadError);
+			it = programs.insert({ run.Executable,{ program,loadError } }).first;
+		}
+		run.Program = it->second.first;
+		if (!run.Program) {
+			run.Status = ERunStatus::InvalidExecutable;
+			run.ErrorMessage = it->second.second;
+		}
+	}
+	NumPrograms = programs.size();
+	return true;
+}
+
+void CBatchRunner::SetTimeSlice(uint64_t timeSlice)
+{
+	TimeSlice = timeSlice;
+}
+
+std::unique_ptr<SBatchSlot> CBatchRunner::CreateSlot()
+{
+	auto slot = std::make_unique<SBatchSlot>();
+	std::ofstream& file = slot->OutputFile;
+	slot->Output = std::make_shared<COutputBuffer>([&file](const char* data, size_t size) { file.write(data, size); });
+	slot->Output->SetFormat(OutputFormat);
+	//еforallѭڵǰִ߳Уⴴ߳
+	slot->Machine = std::make_unique<Pl0VirtualMachine>(MaxStackSize);
+	slot->Machine->SetOutput(slot->Output);
+	slot->Machine->SetNumThreads(1);
+	return slot;
+}
+
+bool CBatchRunner::StartRun(SBatchSlot& slot, size_t index, const std::string& outputDirectory)
+{
+	SBatchRun& run = Runs[index];
+	slot.OutputFile.open(outputDirectory + "/" + std::to_string(index) + ".out", std::ios::binary | std::ios::trunc);
+	//ִļʱ״̬ʹϢڶȡ嵥ʱѾ
+	if (!run.Program) return false;
+
+	std::shared_ptr<CInputReader> input;
+	if (run.InputFile.empty()) input = std::make_shared<CInputReader>(nullptr, 0, EInputFormat::Text);
+	else input = std::make_shared<CInputReader>(run.InputFile, EInputFormat::Text);
+	if (!input->IsOpen()) {
+		run.Status = ERunStatus::InputError;
+		run.ErrorMessage = "Cannot open input file: " + run.InputFile;
+		return false;
+	}
+
+	Pl0VirtualMachine& vm = *slot.Machine;
+	if (!vm.Load(run.Program)) {
+		run.Status = vm.GetStatus();
+		run.ErrorMessage = vm.GetErrorMessage();
+		return false;
+	}
+	vm.SetInput(input);
+	vm.SetSeed(run.Seed);
+	return true;
+}
+
+void CBatchRunner::FinishRun(SBatchSlot& slot, size_t index, bool ran, const std::string& outputDirectory)
+{
+	SBatchRun& run = Runs[index];
+	if (ran) {
+		run.Status = slot.Machine->GetStatus();
+		run.ErrorMessage = slot.Machine->GetErrorMessage();
+		//뵥ʱ׼ͬ
+		if (run.Status == ERunStatus::Finished && OutputFormat == EOutputFormat::Text) {
+			static const char message[] = "========= Program finished =========\n";
+			slot.Output->Write(message, sizeof(message) - 1);
+		}
+		slot.Output->Flush();
+	}
+	slot.OutputFile.close();
+	run.Latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+	std::ofstream statusFile(outputDirectory + "/" + std::to_string(index) + ".status", std::ios::trunc);
+	statusFile << "status: " << GetRunStatusName(run.Status) << "\n";
+	if (!run.ErrorMessage.empty()) statusFile << "message: " << run.ErrorMessage << "\n";
+	statusFile << "seed: " << run.Seed << "\n";
+}
+
+void CBatchRunner::RunToCompletion(const std::string& outputDirectory)
+{
+	uint32_t numWorkers = (uint32_t)std::min<size_t>(NumThreads, Runs.size());
+	std::vector<std::unique_ptr<SBatchSlot>> slots;
+	for (uint32_t i{}; i < numWorkers; i++) {
+		slots.push_back(CreateSlot());
+	}
+
+	CWorkStealingPool pool(numWorkers);
+	pool.Run((uint32_t)Runs.size(), [&](uint32_t index, uint32_t workerIndex) {
+		SBatchSlot& slot = *slots[workerIndex];
+		bool ran = StartRun(slot, index, outputDirectory);
+		if (ran) slot.Machine->Run();
+		FinishRun(slot, index, ran, outputDirectory);
+		});
+}
+
+void CBatchRunner::RunInTimeSlices(const std::string& outputDirectory)
+{
+	//ͬʱеޣÿռһһн嵥еһ
+	constexpr size_t MaxActiveRunsPerThread = 64;
+	size_t numSlots = std::min<size_t>((size_t)NumThreads * MaxActiveRunsPerThread, Runs.size());
+	std::vector<std::unique_ptr<SBatchSlot>> slots;
+	for (size_t i{}; i < numSlots; i++) {
+		slots.push_back(CreateSlot());
+	}
+
+	CScheduler scheduler(NumThreads, TimeSlice);
+	std::atomic<size_t> nextRun{ numSlots };
+	std::function<void(SBatchSlot&, size_t)> start = [&](SBatchSlot& slot, size_t index) {
+		//ִеֱӽһ
+		while (index < Runs.size() && !StartRun(slot, index, outputDirectory)) {
+			FinishRun(slot, index, false, outputDirectory);
+			index = nextRun++;
+		}
+		if (index >= Runs.size()) return;
+		scheduler.Submit(*slot.Machine, 0, [&, index](ERunStatus) {
+			FinishRun(slot, index, true, outputDirectory);
+			start(slot, nextRun++);
+			});
+	};
+	for (size_t i{}; i < numSlots; i++) {
+		start(*slots[i], i);
+	}
+	scheduler.Wait();
+	NumSlices = scheduler.GetNumSlices();
+}
+
+bool CBatchRunner::Run(const std::string& outputDirectory, std::string& errorMessage)
+{
+	std::error_code error;
+	std::filesystem::create_directories(outputDirectory, error);
+	if (!std::filesystem::is_directory(outputDirectory)) {
+		errorMessage = "Cannot create output directory: " + outputDirectory;
+		return false;
+	}
+
+	std::random_device randomDevice;
+	for (auto& run : Runs) {
+		if (!run.bHasSeed) run.Seed = randomDevice() | (uint64_t)randomDevice() << 32;
+	}
+	if (Runs.empty()) return true;
+
+	StartTime = std::chrono::steady_clock::now();
+	if (TimeSlice) RunInTimeSlices(outputDirectory);
+	else RunToCompletion(outputDirectory);
+	Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+	return true;
+}
+
+void CBatchRunner::PrintReport(std::ostream& out) const
+{
+	size_t numFinished = std::count_if(Runs.begin(), Runs.end(), [](const SBatchRun& run) { return run.Status == ERunStatus::Finished; });
+	out << "========= Batch finished =========" << std::endl;
+	out << "runs: " << Runs.size() << ", finished: " << numFinished << ", failed: " << Runs.size() - numFinished << std::endl;
+	out << "executables: " << NumPrograms << ", threads: " << NumThreads;
+	if (TimeSlice) out << ", time slices: " << NumSlices;
+	out << std::endl;
+	out << std::fixed << std::setprecision(3) << "time: " << Seconds << " s, ";
+	out << std::setprecision(1) << (Seconds > 0 ? Runs.size() / Seconds : 0.0) << " runs/s" << std::endl;
+	if (!Runs.empty()) {
+		std::vector<double> latencies;
+		for (auto& run : Runs) {
+			latencies.push_back(run.Latency * 1000);
+		}
+		std::sort(latencies.begin(), latencies.end());
+		out << std::setprecision(3) << "finished after (ms): median " << latencies[latencies.size() / 2]
+			<< ", p99 " << latencies[latencies.size() * 99 / 100] << ", max " << latencies.back() << std::endl;
+	}
+	out << std::defaultfloat;
+}
+
+bool CBatchRunner::AllFinished() const
+{
+	return std::all_of(Runs.begin(), Runs.end(), [](const SBatchRun& run) { return run.Status == ERunStatus::Finished; });
+}
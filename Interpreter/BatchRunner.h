@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Pl0VirtualMachine.h"
+
+//嵥еһ
+struct SBatchRun
+{
+	std::string Executable;
+	uint64_t Seed;
+	bool bHasSeed;						//嵥ûиʱǰѡȡһд״̬ļԱ
+	std::string InputFile;				//Ϊʱû
+	std::shared_ptr<const SProgram> Program;	//ͬһִļйãʧʱΪ
+
+	ERunStatus Status{ ERunStatus::NotLoaded };
+	std::string ErrorMessage;
+	double Latency{};					//пʼнʱ䣬λΪ
+};
+
+//һڶУҪ±ڴ
+struct SBatchSlot
+{
+	std::unique_ptr<Pl0VirtualMachine> Machine;
+	std::shared_ptr<COutputBuffer> Output;
+	std::ofstream OutputFile;			//ǰеļ
+};
+
+/*
+дĳͬһִļֻȡͽһ
+Ĭÿ߳һùȡķʽ䵽̣߳ÿһֱִе
+ָʱƬʱCSchedulerÿ߳ϵĶִУʱܳĳ򲻻֮Ķ̳
+iУ0ʼдĿ¼еi.out״̬дi.status
+*/
+class CBatchRunner
+{
+private:
+	uint32_t NumThreads;
+	uword_t MaxStackSize;
+	EOutputFormat OutputFormat;
+	uint64_t TimeSlice{};				//Ϊ0ʱʱƬ
+	std::vector<SBatchRun> Runs;
+	size_t NumPrograms{};				//ͬĿִļĸ
+	std::chrono::steady_clock::time_point StartTime;
+	double Seconds{};					//ִõʱ
+	uint64_t NumSlices{};
+
+	//һ
+	std::unique_ptr<SBatchSlot> CreateSlot();
+	//򿪵indexеļ򣻲ִʱ״̬false
+	bool StartRun(SBatchSlot& slot, size_t index, const std::string& outputDirectory);
+	//дindexеرļд״̬ļranΪStartRunĽ
+	void FinishRun(SBatchSlot& slot, size_t index, bool ran, const std::string& outputDirectory);
+	void RunToCompletion(const std::string& outputDirectory);
+	void RunInTimeSlices(const std::string& outputDirectory);
+
+public:
+	CBatchRunner(uint32_t numThreads, uword_t maxStackSize, EOutputFormat outputFormat);
+	//ÿִtimeSliceָ֮øͬһ߳ϵ
+	void SetTimeSlice(uint64_t timeSlice);
+
+	/*
+	ȡ嵥ÿΪ"ִļ [ [ļ]]"к#ͷб
+	֮ȡ嵥епִļ嵥ʽʱfalseerrorMessageΪϢ
+	*/
+	bool ReadManifest(const std::string& manifestFile, std::string& errorMessage);
+	//ִ嵥еУĿ¼ʱܴʱfalse
+	bool Run(const std::string& outputDirectory, std::string& errorMessage);
+	//еĴɹʧܵĴԼнʱķֲ
+	void PrintReport(std::ostream& out) const;
+	//ж
+	bool AllFinished() const;
+};
@@ -0,0 +1,268 @@
+#include "HeapAllocator.h"
+#include <algorithm>
+#include <iomanip>
+
+CHeapAllocator::CHeapAllocator(word_t* memory, uword_t base, uword_t size)
+	: Memory(memory), Base(base), Limit(base + size), Top(base)
+{
+}
+
+void CHeapAllocator::Reset()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	Top = Base;
+	FreeLists.fill(0);
+	LargeFreeBlocks.clear();
+	SmallBlocks.clear();
+	LargeBlocks.clear();
+	NumAllocations = NumFrees = InUse = PeakInUse = TotalRequested = TotalAllocated = FreeInLists = 0;
+}
+
+uword_t CHeapAllocator::TakeLargeFreeBlock(uword_t size)
+{
+	//״䣻ʣಿҪܷ¿ͷһԪ
+	for (auto it = LargeFreeBlocks.begin(); it != LargeFreeBlocks.end(); it++) {
+		uword_t address = it->first;
+		uword_t blockSize = it->second;
+		if (blockSize != size && blockSize < size + 2) continue;
+
+		LargeFreeBlocks.erase(it);
+		FreeInLists -= size;
+		if (blockSize > size) {
+			uword_t remainder = address + size;
+			LargeFreeBlocks.insert({ remainder,blockSize - size });
+			Memory[remainder] = -(word_t)(blockSize - size - 1);
+		}
+		return address;
+	}
+	return 0;
+}
+
+void CHeapAllocator::InsertLargeFreeBlock(uword_t address, uword_t size)
+{
+	FreeInLists += size;
+
+	//һпϲ
+	auto next = LargeFreeBlocks.find(address + size);
+	if (next != LargeFreeBlocks.end()) {
+		size += next->second;
+		LargeFreeBlocks.erase(next);
+	}
+	//ǰһпϲ
+	auto it = LargeFreeBlocks.lower_bound(address);
+	if (it != LargeFreeBlocks.begin()) {
+		auto previous = std::prev(it);
+		if (previous->first + previous->second == address) {
+			address = previous->first;
+			size += previous->second;
+			LargeFreeBlocks.erase(previous);
+		}
+	}
+
+	//TopĿпֱӻδĲ
+	if (address + size == Top) {
+		Top = address;
+		FreeInLists -= size;
+		return;
+	}
+	LargeFreeBlocks.insert({ address,size });
+	Memory[address] = -(word_t)(size - 1);
+}
+
+uword_t CHeapAllocator::AllocateBlock(uword_t size)
+{
+	if (!LargeFreeBlocks.empty()) {
+		uword_t address = TakeLargeFreeBlock(size);
+		if (address) return address;
+	}
+	if (Limit - Top < size) return 0;
+	uword_t address = Top;
+	Top += size;
+	return address;
+}
+
+bool CHeapAllocator::IsSmallBlock(uword_t address) const
+{
+	uword_t index = address - Base;
+	return index / 64 < SmallBlocks.size() && (SmallBlocks[index / 64] >> (index % 64) & 1);
+}
+
+void CHeapAllocator::MarkSmallBlock(uword_t address, bool allocated)
+{
+	uword_t index = address - Base;
+	if (index / 64 >= SmallBlocks.size()) SmallBlocks.resize(index / 64 + 1);
+	if (allocated) SmallBlocks[index / 64] |= (uint64_t)1 << (index % 64);
+	else SmallBlocks[index / 64] &= ~((uint64_t)1 << (index % 64));
+}
+
+uword_t CHeapAllocator::TakeFromFreeList(uword_t sizeClass)
+{
+	uword_t address = FreeLists[sizeClass];
+	if (!address) return 0;
+	//ͷźĿԿܱдеĿõĲСδ䣬ҿͷСĿп
+	word_t size = (word_t)SizeClasses[sizeClass];
+	if (address <= Base || address >= Top || Top - address < (uword_t)size || IsSmallBlock(address) || Memory[address - 1] != -size) {
+		FreeLists[sizeClass] = 0;
+		return 0;
+	}
+	FreeLists[sizeClass] = Memory[address];
+	FreeInLists -= size + 1;
+	return address;
+}
+
+uword_t CHeapAllocator::Allocate(uword_t size)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	if (size == 0) size = 1;
+	TotalRequested += size;
+
+	uword_t address;
+	if (size <= MaxSmallSize) {
+		uword_t sizeClass = std::lower_bound(SizeClasses.begin(), SizeClasses.end(), size) - SizeClasses.begin();
+		size = SizeClasses[sizeClass];
+		address = TakeFromFreeList(sizeClass);
+		if (!address) {
+			uword_t header = AllocateBlock(size + 1);
+			if (!header) return 0;
+			address = header + 1;
+		}
+		MarkSmallBlock(address, true);
+	}
+	else {
+		if (size > Limit - Base) return 0;
+		uword_t header = AllocateBlock(size + 1);
+		if (!header) return 0;
+		address = header + 1;
+		LargeBlocks.insert({ address,size });
+	}
+	Memory[address - 1] = size;
+
+	NumAllocations++;
+	TotalAllocated += size;
+	InUse += size;
+	PeakInUse = std::max(PeakInUse, InUse);
+	return address;
+}
+
+bool CHeapAllocator::Free(uword_t address)
+{
+	if (address == 0) return true;
+
+	std::lock_guard<std::mutex> lock(Mutex);
+	if (address <= Base || address >= Top) return false;
+
+	//ѷĿĵַָм䣩ѾͷŹ
+	uword_t size;
+	auto large = LargeBlocks.find(address);
+	if (large != LargeBlocks.end()) {
+		size = large->second;
+		LargeBlocks.erase(large);
+		InsertLargeFreeBlock(address - 1, size + 1);
+	}
+	else if (IsSmallBlock(address)) {
+		//ͷܱԽдСһС࣬ҿ鲻õĲ
+		size = (uword_t)Memory[address - 1];
+		auto it = std::lower_bound(SizeClasses.begin(), SizeClasses.end(), size);
+		if (it == SizeClasses.end() || *it != size || Top - address < size) return false;
+		uword_t sizeClass = it - SizeClasses.begin();
+		MarkSmallBlock(address, false);
+		Memory[address - 1] = -(word_t)size;
+		Memory[address] = FreeLists[sizeClass];
+		FreeLists[sizeClass] = address;
+		FreeInLists += size + 1;
+	}
+	else return false;
+
+	NumFrees++;
+	InUse -= size;
+	return true;
+}
+
+void CHeapAllocator::PrintStats(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	uword_t arenaSize = Top - Base;
+	out << "========= Heap statistics =========" << std::endl;
+	out << "allocations: " << NumAllocations << ", frees: " << NumFrees << std::endl;
+	out << "in use: " << InUse << " units, peak: " << PeakInUse << " units" << std::endl;
+	out << std::fixed << std::setprecision(1);
+	out << "arena: " << arenaSize << " of " << Limit - Base << " units, free blocks: " << FreeInLists << " units ("
+		<< (arenaSize ? 100.0 * FreeInLists / arenaSize : 0.0) << "% of arena)" << std::endl;
+	out << "size class rounding: " << TotalAllocated - TotalRequested << " units ("
+		<< (TotalAllocated ? 100.0 * (TotalAllocated - TotalRequested) / TotalAllocated : 0.0) << "% of allocated)" << std::endl;
+	out << std::defaultfloat;
+}
+
+uword_t CHeapAllocator::GetBase() const
+{
+	return Base;
+}
+
+uword_t CHeapAllocator::GetTop()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Top;
+}
+
+std::vector<uint64_t> CHeapAllocator::SaveState()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	std::vector<uint64_t> state{ Top };
+	state.insert(state.end(), FreeLists.begin(), FreeLists.end());
+	state.insert(state.end(), { NumAllocations,NumFrees,InUse,PeakInUse,TotalRequested,TotalAllocated,FreeInLists });
+	state.insert(state.end(), { LargeFreeBlocks.size(),LargeBlocks.size() });
+	for (auto [address, size] : LargeFreeBlocks) {
+		state.push_back(address);
+		state.push_back(size);
+	}
+	for (auto [address, size] : LargeBlocks) {
+		state.push_back(address);
+		state.push_back(size);
+	}
+	//Top֮ûѷС飬λͼֻ浽TopΪֹ
+	size_t numWords = std::min<size_t>(SmallBlocks.size(), (Top - Base + 63) / 64);
+	state.insert(state.end(), SmallBlocks.begin(), SmallBlocks.begin() + numWords);
+	return state;
+}
+
+bool CHeapAllocator::RestoreState(const std::vector<uint64_t>& state)
+{
+	constexpr size_t NumFixed = 1 + NumSizeClasses + 7 + 2;
+	if (state.size() < NumFixed) return false;
+	uint64_t top = state[0];
+	if (top < Base || top > Limit) return false;
+	uint64_t numLargeFree = state[NumFixed - 2];
+	uint64_t numLarge = state[NumFixed - 1];
+	if (numLargeFree > state.size() || numLarge > state.size()) return false;
+	size_t bitmapStart = NumFixed + 2 * (size_t)(numLargeFree + numLarge);
+	if (bitmapStart > state.size() || state.size() - bitmapStart > (top - Base + 63) / 64) return false;
+	//ַֻõĲУɿеĶڴ
+	for (uword_t i{}; i < NumSizeClasses; i++) {
+		if (state[1 + i] != 0 && (state[1 + i] < Base || state[1 + i] >= top)) return false;
+	}
+	for (size_t i = NumFixed; i < bitmapStart; i += 2) {
+		if (state[i] < Base || state[i] >= top || state[i + 1] > top - state[i]) return false;
+	}
+
+	std::lock_guard<std::mutex> lock(Mutex);
+	Top = (uword_t)top;
+	for (uword_t i{}; i < NumSizeClasses; i++) {
+		FreeLists[i] = (uword_t)state[1 + i];
+	}
+	const uint64_t* stats = state.data() + 1 + NumSizeClasses;
+	NumAllocations = stats[0];
+	NumFrees = stats[1];
+	InUse = stats[2];
+	PeakInUse = stats[3];
+	TotalRequested = stats[4];
+	TotalAllocated = stats[5];
+	FreeInLists = stats[6];
+	LargeFreeBlocks.clear();
+	LargeBlocks.clear();
+	for (size_t i = NumFixed; i < bitmapStart; i += 2) {
+		auto& blocks = i < NumFixed + 2 * numLargeFree ? LargeFreeBlocks : LargeBlocks;
+		blocks.insert({ (uword_t)state[i],(uword_t)state[i + 1] });
+	}
+	SmallBlocks.assign(state.begin() + bitmapStart, state.end());
+	return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "Instruction.h"
+
+/*
+Ķѣλڴջ֮һnewfreeõʹõĵַջеĵַͬԵԪΪλ±
+ÿ֮ǰһԪĿͷĴСͷѷĿΪеĿΪ
+MaxSmallSizeȡɸС֮һÿСһnextڿпĵһԪ
+ʹðַĿп״䣬ͷʱڵĿпϲ
+ûкʵĿʱͷƶTopµĿ飬̲Ҫϵͳ
+ͷͿڳԸдĶڴУͷʱ÷Լ¼ѷĿַſͷе
+*/
+class CHeapAllocator
+{
+private:
+	static constexpr uword_t NumSizeClasses = 22;
+	static constexpr std::array<uword_t, NumSizeClasses> SizeClasses = { 1,2,3,4,6,8,12,16,24,32,48,64,96,128,192,256,384,512,768,1024,1536,2048 };
+	static constexpr uword_t MaxSmallSize = 2048;
+
+	word_t* Memory;
+	uword_t Base;							//ʼַ
+	uword_t Limit;							//Ľַ
+	uword_t Top;							//δĲֵʼַ
+
+	std::array<uword_t, NumSizeClasses> FreeLists{};	//СĿĵһĵַ0
+	std::map<uword_t, uword_t> LargeFreeBlocks;		//Ŀп飬ͷַ -> ͷڵĴС
+	std::vector<uint64_t> SmallBlocks;		//ѷСλͼַΪaddressСӦaddress - Baseλ
+	std::map<uword_t, uword_t> LargeBlocks;	//ѷĴ飬ַ -> Сͷ
+	std::mutex Mutex;						//forallѭĸ̹߳һ
+
+	//ͳϢλǵԪ
+	uint64_t NumAllocations{};
+	uint64_t NumFrees{};
+	uint64_t InUse{};						//ѷĿĴС֮ͣͷ
+	uint64_t PeakInUse{};
+	uint64_t TotalRequested{};				//ĴС֮
+	uint64_t TotalAllocated{};				//зĿĴС֮ͣTotalRequestedĲȡС˷ѵĲ
+	uint64_t FreeInLists{};					//ͿпеĿĴС֮ͣͷ
+
+	//ӴпȡһǡsizeԪͷĿ飬ĲַŻرУû򷵻0
+	uword_t TakeLargeFreeBlock(uword_t size);
+	//[address, address + size)ΪппڵĿпϲ
+	void InsertLargeFreeBlock(uword_t address, uword_t size);
+	//ͷsizeԪʹÿпؿͷַʱ0
+	uword_t AllocateBlock(uword_t size);
+	bool IsSmallBlock(uword_t address) const;
+	void MarkSmallBlock(uword_t address, bool allocated);
+	//ӴСĿȡһ飬ĵַΪջ߱дʱ0
+	uword_t TakeFromFreeList(uword_t sizeClass);
+
+public:
+	CHeapAllocator(word_t* memory, uword_t base, uword_t size);
+	//ͷеĿ鲢ͳϢصմʱ״̬ѵڴ
+	void Reset();
+
+	//sizeԪصһԪĵַδʼѿռ䲻ʱ0
+	uword_t Allocate(uword_t size);
+	//ͷAllocateõĵַaddressΪ0ʱʲôҲַЧظͷʱfalse
+	bool Free(uword_t address);
+	//ʹֵԼƬͳ
+	void PrintStats(std::ostream& out);
+
+	//õĲΪ[ѵʼַ, GetTop())ֻҪһڴ
+	uword_t GetBase() const;
+	uword_t GetTop();
+	//ڴȫ״̬TopпѷĿͳϢnextڶڴУɵⱣ
+	std::vector<uint64_t> SaveState();
+	//ָSaveStateõ״̬ݲϷʱfalse״̬
+	bool RestoreState(const std::vector<uint64_t>& state);
+};
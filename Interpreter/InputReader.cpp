@@ -0,0 +1,189 @@
+#include "InputReader.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool IsSpace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+CInputReader::CInputReader(EInputFormat format) : FileDescriptor(0), Format(format)
+{
+#ifdef _WIN32
+	if (Format == EInputFormat::Binary) _setmode(FileDescriptor, _O_BINARY);
+#endif
+}
+
+CInputReader::CInputReader(const std::string& fileName, EInputFormat format) : Format(format)
+{
+#ifdef _WIN32
+	FileDescriptor = _open(fileName.c_str(), _O_RDONLY | _O_BINARY);
+#else
+	FileDescriptor = open(fileName.c_str(), O_RDONLY);
+#endif
+	if (FileDescriptor < 0) return;
+	bOwnsFile = true;
+
+#ifndef _WIN32
+	//ͨļӳ䵽ڴУܵȲӳļȻȡ
+	struct stat status;
+	if (fstat(FileDescriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+		void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+		if (mapping != MAP_FAILED) {
+			madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+			Mapping = mapping;
+			MappingSize = status.st_size;
+			Data = (const char*)mapping;
+			Size = MappingSize;
+			bEndOfFile = true;
+		}
+	}
+#endif
+}
+
+CInputReader::CInputReader(const char* data, size_t size, EInputFormat format) : Format(format), Data(data), Size(size), bEndOfFile(true)
+{
+}
+
+CInputReader::~CInputReader()
+{
+#ifndef _WIN32
+	if (Mapping) munmap(Mapping, MappingSize);
+#endif
+	if (bOwnsFile) {
+#ifdef _WIN32
+		_close(FileDescriptor);
+#else
+		close(FileDescriptor);
+#endif
+	}
+}
+
+bool CInputReader::IsOpen() const
+{
+	//ڴȡʱûļѾȫڴ
+	return FileDescriptor >= 0 || bEndOfFile;
+}
+
+size_t CInputReader::ReadFile(char* dst, size_t size)
+{
+	while (true) {
+#ifdef _WIN32
+		int result = _read(FileDescriptor, dst, (unsigned int)std::min<size_t>(size, 1 << 30));
+#else
+		ssize_t result = read(FileDescriptor, dst, size);
+		if (result < 0 && errno == EINTR) continue;
+#endif
+		return result > 0 ? result : 0;
+	}
+}
+
+bool CInputReader::Fill()
+{
+	if (bEndOfFile) return false;
+	if (!Buffer) {
+		Buffer.reset(new char[ChunkSize]);
+	}
+
+	//δƵͷ֮һΣʽÿֻܶһ
+	size_t remaining = Size - Position;
+	if (remaining) std::memmove(Buffer.get(), Data + Position, remaining);
+	Data = Buffer.get();
+	Position = 0;
+	Size = remaining;
+	size_t count = ReadFile(Buffer.get() + Size, ChunkSize - Size);
+	if (count == 0) {
+		bEndOfFile = true;
+		return false;
+	}
+	Size += count;
+	return true;
+}
+
+EReadStatus CInputReader::ReadText(word_t& value)
+{
+	while (true) {
+		while (Position < Size && IsSpace(Data[Position])) Position++;
+		if (Position == Size) {
+			if (!Fill()) return EReadStatus::End;
+			continue;
+		}
+
+		//һܱУʱһ½
+		size_t end = Position;
+		while (end < Size && !IsSpace(Data[end])) end++;
+		if (end == Size && end - Position < MaxNumberLength && Fill()) continue;
+
+		auto [pointer, error] = std::from_chars(Data + Position, Data + end, value);
+		if (error == std::errc::result_out_of_range) return EReadStatus::OutOfRange;
+		if (error != std::errc{} || pointer != Data + end) return EReadStatus::Invalid;
+		Position = end;
+		return EReadStatus::Ok;
+	}
+}
+
+EReadStatus CInputReader::Read(word_t& value)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	if (Format == EInputFormat::Text) return ReadText(value);
+
+	while (Size - Position < sizeof(value)) {
+		if (!Fill()) return Size == Position ? EReadStatus::End : EReadStatus::Invalid;
+	}
+	std::memcpy(&value, Data + Position, sizeof(value));
+	Position += sizeof(value);
+	return EReadStatus::Ok;
+}
+
+EReadStatus CInputReader::ReadArray(word_t* dst, uword_t n, uword_t& count)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	count = 0;
+	if (Format == EInputFormat::Text) {
+		for (; count < n; count++) {
+			EReadStatus status = ReadText(dst[count]);
+			if (status == EReadStatus::End) break;
+			if (status != EReadStatus::Ok) return status;
+		}
+		return EReadStatus::Ok;
+	}
+
+	//ȸѾڴеĲ֣ļӳʱȫʣµֱӴļ飬
+	char* out = (char*)dst;
+	size_t wanted = (size_t)n * sizeof(word_t);
+	size_t copied = std::min(wanted, Size - Position);
+	if (copied) std::memcpy(out, Data + Position, copied);
+	Position += copied;
+	bool readDirectly = false;
+	while (copied < wanted && !bEndOfFile) {
+		size_t bytes = ReadFile(out + copied, wanted - copied);
+		if (bytes == 0) bEndOfFile = true;
+		copied += bytes;
+		readDirectly = true;
+	}
+
+	//һֵĲһζȡ
+	count = copied / sizeof(word_t);
+	size_t leftover = copied % sizeof(word_t);
+	if (readDirectly) {
+		if (!Buffer) Buffer.reset(new char[ChunkSize]);
+		std::memcpy(Buffer.get(), out + count * sizeof(word_t), leftover);
+		Data = Buffer.get();
+		Position = 0;
+		Size = leftover;
+	}
+	else {
+		Position -= leftover;
+	}
+	return EReadStatus::Ok;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Instruction.h"
+
+//readreadarrayʽıΪԿհ׷ָʮΪֽ֣򣩣--binary-outputͬ
+enum class EInputFormat
+{
+	Text,
+	Binary
+};
+
+//ȡĽ
+enum class EReadStatus
+{
+	Ok,
+	End,					//Ѿ
+	Invalid,				//ı
+	OutOfRange				//ֳķΧ
+};
+
+/*
+룺ļmmapӳ䵽ڴУֱӳڴϽҪreadϵͳúͶĸƣļʱֻһmemcpy
+׼루Լ֧mmapƽ̨ÿζһ鵽
+*/
+class CInputReader
+{
+private:
+	static constexpr size_t ChunkSize = 1 << 20;
+	static constexpr size_t MaxNumberLength = 32;		//һΧٵȴ֮
+
+	int FileDescriptor{ -1 };
+	bool bOwnsFile{};
+	EInputFormat Format;
+	const char* Data{};				//δΪ[Data + Position, Data + Size)
+	size_t Position{};
+	size_t Size{};
+	void* Mapping{};				//ļӳ䣬ΪʱʹBuffer
+	size_t MappingSize{};
+	std::unique_ptr<char[]> Buffer;
+	bool bEndOfFile{};				//ļеѾȫ뻺
+	std::mutex Mutex;				//forallѭĸ̹߳һ
+
+	//δƵͷٶһΣѾʱfalse
+	bool Fill();
+	//ļжȡsizeֽڵdstʵʶֽ
+	size_t ReadFile(char* dst, size_t size);
+	EReadStatus ReadText(word_t& value);
+
+public:
+	//ӱ׼ȡ
+	explicit CInputReader(EInputFormat format);
+	//ļȡļܴʱIsOpen()false
+	CInputReader(const std::string& fileName, EInputFormat format);
+	//ڴе[data, data + size)ȡƣȡڼݱЧsizeΪ0ʱǿյ
+	CInputReader(const char* data, size_t size, EInputFormat format);
+	~CInputReader();
+	CInputReader(const CInputReader&) = delete;
+	CInputReader& operator=(const CInputReader&) = delete;
+
+	bool IsOpen() const;
+	EReadStatus Read(word_t& value);
+	//ȡndstcountΪʵʶĸʱOkcountСn
+	EReadStatus ReadArray(word_t* dst, uword_t n, uword_t& count);
+};
@@ -1,26 +1,311 @@
 ﻿#include <iostream>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
 #include "Pl0VirtualMachine.h"
+#include "BatchRunner.h"
+#include "Server.h"
+#include <csignal>
+
+static volatile std::sig_atomic_t SnapshotRequested;
+
+static void RequestSnapshot(int)
+{
+	SnapshotRequested = 1;
+}
+
+//执行程序，期间收到SIGUSR1时保存快照；只在两段RunFor之间保存，此时虚拟机的状态是完整的
+static ERunStatus RunWithSnapshots(Pl0VirtualMachine& vm, const std::string& snapshotFile)
+{
+#ifdef _WIN32
+	return vm.Run();
+#else
+	signal(SIGUSR1, RequestSnapshot);
+	ERunStatus status;
+	while ((status = vm.RunFor(1 << 20)) == ERunStatus::Suspended) {
+		if (!SnapshotRequested) continue;
+		SnapshotRequested = 0;
+		std::string errorMessage;
+		if (vm.SaveSnapshot(snapshotFile, errorMessage)) std::cerr << "Snapshot saved to " << snapshotFile << std::endl;
+		else std::cerr << errorMessage << std::endl;
+	}
+	return status;
+#endif
+}
 
 void ShowUsage()
 {
 	std::cout << "Usage: \n\n";
-	std::cout << "Interpreter <ExecutableFilePath>\n";
+	std::cout << "Interpreter [--threads N] [--seed N] [--max-stack MB] [--heap-stats] [--line-buffered] [--binary-output] [--input FILE] [--binary-input] [--snapshot FILE] [--restore FILE] [--profile FILE] [--profile-folded FILE] <ExecutableFilePath>\n";
+	std::cout << "Interpreter --batch [--threads N] [--max-stack MB] [--binary-output] [--output-dir DIR] [--time-slice N] <ManifestFilePath>\n";
+	std::cout << "Interpreter --serve [--threads N] [--max-stack MB] <SocketPath>\n";
+	std::cout << "Interpreter --connect SOCKET [--seed N] [--binary-output] [--input FILE] [--binary-input] <ExecutableFilePath>\n\n";
+	std::cout << "--threads N    number of threads used by forall loops, default is the number of hardware threads\n";
+	std::cout << "--seed N       seed of random(), runs with the same seed give the same results\n";
+	std::cout << "--max-stack MB maximum size of the stack, default is 1024; memory is only used when touched\n";
+	std::cout << "--heap-stats   print heap allocation statistics to stderr when the program finishes\n";
+	std::cout << "--line-buffered write each printed value immediately, default only when stdout is a terminal\n";
+	std::cout << "--binary-output write printed values as raw " << WordBits << "-bit integers in native byte order\n";
+	std::cout << "--input FILE   read() and readarray() read from FILE instead of stdin\n";
+	std::cout << "--binary-input input is raw " << WordBits << "-bit integers in native byte order instead of text\n";
+	std::cout << "--snapshot FILE snapshot statements (and SIGUSR1) save the state of the program to FILE\n";
+	std::cout << "--restore FILE start from the state saved in FILE instead of the beginning of the program\n";
+	std::cout << "--profile FILE write instructions and time per procedure and per source line to FILE, using <ExecutableFilePath>.sym\n";
+	std::cout << "--profile-folded FILE write folded call stacks weighted by microseconds to FILE, for flamegraph.pl\n";
+	std::cout << "--batch        run every line \"executable [seed [input file]]\" of the manifest, N runs at a time\n";
+	std::cout << "--output-dir DIR directory of the i.out and i.status files of batch runs, default is the current directory\n";
+	std::cout << "--serve        keep running and execute programs sent to the Unix socket, with warm VMs and cached code\n";
+	std::cout << "--connect SOCKET run the program on the server listening on SOCKET\n";
+	std::cout << "--time-slice N run many batch runs per thread in turns of N instructions, so long runs do not hold up short ones\n";
 	exit(0);
 }
 
 int main(int argc, char** argv)
 {
 	
-	//从命令行参数中获取文件路径
-	if(argc != 2)
+	//从命令行参数中获取选项和文件路径
+	uint32_t numThreads{};
+	bool printHeapStats{};
+	bool hasSeed{};
+	uint64_t seed{};
+	bool lineBuffered{};
+	EOutputFormat outputFormat = EOutputFormat::Text;
+	std::string inputFile;
+	EInputFormat inputFormat = EInputFormat::Text;
+	bool batch{};
+	std::string outputDirectory = ".";
+	uint64_t timeSlice{};
+	bool serve{};
+	std::string serverSocket;
+	std::string snapshotFile;
+	std::string restoreFile;
+	std::string profileFile;
+	std::string foldedProfileFile;
+	uword_t maxStackSize = Pl0VirtualMachine::DefaultMaxStackSize;
+	int argIndex = 1;
+	while (argIndex < argc - 1) {
+		std::string option = argv[argIndex];
+		if (option == "--threads") {
+			int value = std::atoi(argv[argIndex + 1]);
+			if (value <= 0) ShowUsage();
+			numThreads = value;
+			argIndex += 2;
+		}
+		else if (option == "--seed") {
+			char* end;
+			seed = std::strtoull(argv[argIndex + 1], &end, 10);
+			if (*end != '\0' || end == argv[argIndex + 1]) ShowUsage();
+			hasSeed = true;
+			argIndex += 2;
+		}
+		else if (option == "--max-stack") {
+			//这里只保证换算成单元数时不溢出，超出地址空间时由虚拟机报错
+			constexpr long long MaxStackMB = std::min<long long>(std::numeric_limits<uword_t>::max() / (1024 * 1024 / sizeof(word_t)), 1LL << 30);
+			long long value = std::atoll(argv[argIndex + 1]);
+			if (value <= 0 || value > MaxStackMB) ShowUsage();
+			maxStackSize = (uword_t)value * (1024 * 1024 / sizeof(word_t));
+			argIndex += 2;
+		}
+		else if (option == "--heap-stats") {
+			printHeapStats = true;
+			argIndex++;
+		}
+		else if (option == "--line-buffered") {
+			lineBuffered = true;
+			argIndex++;
+		}
+		else if (option == "--binary-output") {
+			outputFormat = EOutputFormat::Binary;
+			argIndex++;
+		}
+		else if (option == "--input") {
+			inputFile = argv[argIndex + 1];
+			if (inputFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--binary-input") {
+			inputFormat = EInputFormat::Binary;
+			argIndex++;
+		}
+		else if (option == "--snapshot") {
+			snapshotFile = argv[argIndex + 1];
+			if (snapshotFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--restore") {
+			restoreFile = argv[argIndex + 1];
+			if (restoreFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--profile") {
+			profileFile = argv[argIndex + 1];
+			if (profileFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--profile-folded") {
+			foldedProfileFile = argv[argIndex + 1];
+			if (foldedProfileFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--batch") {
+			batch = true;
+			argIndex++;
+		}
+		else if (option == "--serve") {
+			serve = true;
+			argIndex++;
+		}
+		else if (option == "--connect") {
+			serverSocket = argv[argIndex + 1];
+			if (serverSocket.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--time-slice") {
+			long long value = std::atoll(argv[argIndex + 1]);
+			if (value <= 0) ShowUsage();
+			timeSlice = value;
+			argIndex += 2;
+		}
+		else if (option == "--output-dir") {
+			outputDirectory = argv[argIndex + 1];
+			if (outputDirectory.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else break;
+	}
+	if(argc - argIndex != 1)
 		ShowUsage();
 
-	Pl0VirtualMachine vm{argv[1]};
-	vm.Run();
-	
+	if (batch) {
+		CBatchRunner runner{ numThreads ? numThreads : std::max<uint32_t>(std::thread::hardware_concurrency(), 1),maxStackSize,outputFormat };
+		runner.SetTimeSlice(timeSlice);
+		std::string errorMessage;
+		if (!runner.ReadManifest(argv[argIndex], errorMessage) || !runner.Run(outputDirectory, errorMessage)) {
+			std::cerr << errorMessage << std::endl;
+			return 1;
+		}
+		runner.PrintReport(std::cout);
+		return runner.AllFinished() ? 0 : 1;
+	}
 
-	/*
-	Pl0VirtualMachine vm{ "test" };
-	vm.Run();
-	*/
-}
+	if (serve) {
+		CServer server{ argv[argIndex],numThreads ? numThreads : std::max<uint32_t>(std::thread::hardware_concurrency(), 1),maxStackSize };
+		std::string errorMessage;
+		if (!server.Listen(errorMessage)) {
+			std::cerr << errorMessage << std::endl;
+			return 1;
+		}
+		std::cerr << "Listening on " << argv[argIndex] << std::endl;
+		server.Run();
+		return 1;
+	}
+
+	//输出和输入由这里创建，虚拟机只负责执行
+	auto output = std::make_shared<COutputBuffer>();
+	output->SetFormat(outputFormat);
+	if (lineBuffered) output->SetLineBuffered(true);
+	std::shared_ptr<CInputReader> input;
+	if (inputFile.empty()) input = std::make_shared<CInputReader>(inputFormat);
+	else input = std::make_shared<CInputReader>(inputFile, inputFormat);
+	if (!input->IsOpen()) {
+		std::cerr << "Cannot open input file: " << inputFile << std::endl;
+		return 1;
+	}
+
+	if (!serverSocket.empty()) {
+		//由常驻解释器执行，输入整个发送过去
+		std::string executable, inputData, errorMessage;
+		std::ifstream executableFile(argv[argIndex], std::ios::binary);
+		if (!executableFile.is_open()) {
+			std::cerr << "Cannot open file: " << argv[argIndex] << std::endl;
+			return 1;
+		}
+		executable.assign(std::istreambuf_iterator<char>(executableFile), std::istreambuf_iterator<char>());
+		if (!inputFile.empty()) {
+			std::ifstream file(inputFile, std::ios::binary);
+			inputData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+		uint32_t flags = (hasSeed ? RequestHasSeed : 0) | (outputFormat == EOutputFormat::Binary ? RequestBinaryOutput : 0)
+			| (inputFormat == EInputFormat::Binary ? RequestBinaryInput : 0);
+
+		CServerClient client;
+		ERunStatus status;
+		if (!client.Connect(serverSocket, errorMessage) || !client.Run(executable, inputData, flags, seed,
+			[&](const char* data, size_t size) { output->Write(data, size); output->Flush(); }, status, errorMessage))
+		{
+			output->Flush();
+			std::cerr << errorMessage << std::endl;
+			return 1;
+		}
+		if (status != ERunStatus::Finished) {
+			output->Flush();
+			std::cerr << errorMessage << std::endl;
+			return 1;
+		}
+		if (outputFormat == EOutputFormat::Text) {
+			static const char message[] = "========= Program finished =========\n";
+			output->Write(message, sizeof(message) - 1);
+		}
+		return 0;
+	}
+
+	Pl0VirtualMachine vm{ maxStackSize };
+	vm.SetOutput(output);
+	vm.SetInput(input);
+	if (numThreads) vm.SetNumThreads(numThreads);
+	if (!vm.Load(argv[argIndex])) {
+		std::cerr << vm.GetErrorMessage() << std::endl;
+		return 1;
+	}
+	//指定种子时从快照恢复后也用这个种子，否则继续快照中的随机数序列
+	if (!restoreFile.empty() && !vm.RestoreSnapshot(restoreFile)) {
+		std::cerr << vm.GetErrorMessage() << std::endl;
+		return 1;
+	}
+	if (hasSeed) vm.SetSeed(seed);
+	vm.SetSnapshotFile(snapshotFile);
+
+	//符号表由编译器的--symbols写在可执行文件旁边，没有时仍然可以按地址分析
+	bool profiling = !profileFile.empty() || !foldedProfileFile.empty();
+	if (profiling) {
+		std::string symbolFile = std::string(argv[argIndex]) + ".sym";
+		std::shared_ptr<const SSymbolTable> symbols;
+		std::string errorMessage;
+		if (!std::filesystem::exists(symbolFile)) {
+			std::cerr << "Warning: no symbol table, compile with --symbols to see procedure names and source lines" << std::endl;
+		}
+		else if (!(symbols = CProfiler::ReadSymbols(symbolFile, errorMessage))) {
+			std::cerr << "Warning: " << errorMessage << std::endl;
+		}
+		vm.EnableProfiling(symbols);
+		if (symbols && !vm.GetProfiler()->HasSymbols()) {
+			std::cerr << "Warning: the symbol file " << symbolFile << " does not match the executable" << std::endl;
+		}
+	}
+
+	ERunStatus status = snapshotFile.empty() ? vm.Run() : RunWithSnapshots(vm, snapshotFile);
+	//程序出错时也输出已经执行的部分的分析结果
+	if (profiling) {
+		std::string errorMessage;
+		if (!vm.GetProfiler()->WriteFiles(profileFile, foldedProfileFile, errorMessage)) {
+			std::cerr << errorMessage << std::endl;
+			return 1;
+		}
+	}
+	if (status != ERunStatus::Finished) {
+		std::cerr << vm.GetErrorMessage() << std::endl;
+		return 1;
+	}
+	//二进制输出只包含print输出的数
+	if (outputFormat == EOutputFormat::Text) {
+		static const char message[] = "========= Program finished =========\n";
+		output->Write(message, sizeof(message) - 1);
+	}
+	output->Flush();
+	if (printHeapStats) vm.PrintHeapStats(std::cerr);
+	return 0;
+}
\ No newline at end of file
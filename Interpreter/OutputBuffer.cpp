@@ -0,0 +1,147 @@
+#include "OutputBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
+
+//ǰ׼ĻջʱźŴд
+static std::atomic<COutputBuffer*> StandardOutput;
+
+//дȫݣֻʹwriteźŴеãرգܵĶ˳ʱʣµ
+static void WriteAll(int fileDescriptor, const char* data, size_t size)
+{
+	while (size > 0) {
+#ifdef _WIN32
+		int written = _write(fileDescriptor, data, (unsigned int)std::min<size_t>(size, 1 << 30));
+#else
+		ssize_t written = write(fileDescriptor, data, size);
+		if (written < 0 && errno == EINTR) continue;
+#endif
+		if (written <= 0) return;
+		data += written;
+		size -= written;
+	}
+}
+
+static bool IsTerminal(int fileDescriptor)
+{
+#ifdef _WIN32
+	return _isatty(fileDescriptor);
+#else
+	return isatty(fileDescriptor);
+#endif
+}
+
+COutputBuffer::COutputBuffer(int fileDescriptor) : FileDescriptor(fileDescriptor), Buffer(new char[BufferSize])
+{
+	bLineBuffered = IsTerminal(FileDescriptor);
+	if (FileDescriptor == 1) StandardOutput.store(this);
+}
+
+COutputBuffer::COutputBuffer(std::function<void(const char*, size_t)> sink) : Sink(std::move(sink)), Buffer(new char[BufferSize])
+{
+}
+
+COutputBuffer::~COutputBuffer()
+{
+	Flush();
+	COutputBuffer* self = this;
+	StandardOutput.compare_exchange_strong(self, nullptr);
+}
+
+void COutputBuffer::SetFormat(EOutputFormat format)
+{
+	Format = format;
+#ifdef _WIN32
+	//WindowsĬıģʽ򿪱׼\nתΪ\r\n
+	if (Format == EOutputFormat::Binary && FileDescriptor >= 0) _setmode(FileDescriptor, _O_BINARY);
+#endif
+}
+
+EOutputFormat COutputBuffer::GetFormat() const
+{
+	return Format;
+}
+
+void COutputBuffer::SetLineBuffered(bool lineBuffered)
+{
+	bLineBuffered = lineBuffered;
+}
+
+void COutputBuffer::WriteNumber(word_t value)
+{
+	if (BufferSize - Size < MaxNumberLength) Flush();
+
+	char* p = Buffer.get() + Size;
+	if (Format == EOutputFormat::Binary) {
+		std::memcpy(p, &value, sizeof(value));
+		Size += sizeof(value);
+	}
+	else {
+		//std::to_charsãҲڴ棬iostreamö
+		char* end = std::to_chars(p, p + MaxNumberLength, value).ptr;
+		*end++ = '\n';
+		Size += end - p;
+	}
+
+	if (bLineBuffered) Flush();
+}
+
+void COutputBuffer::AppendNumber(std::string& out, word_t value) const
+{
+	if (Format == EOutputFormat::Binary) {
+		out.append((const char*)&value, sizeof(value));
+	}
+	else {
+		char text[MaxNumberLength];
+		char* end = std::to_chars(text, text + MaxNumberLength, value).ptr;
+		*end++ = '\n';
+		out.append(text, end);
+	}
+}
+
+void COutputBuffer::Write(const char* data, size_t size)
+{
+	if (BufferSize - Size < size) {
+		Flush();
+		//Ȼֱд
+		if (size > BufferSize) {
+			std::lock_guard<std::mutex> lock(FlushMutex);
+			if (Sink) Sink(data, size);
+			else WriteAll(FileDescriptor, data, size);
+			return;
+		}
+	}
+	std::memcpy(Buffer.get() + Size, data, size);
+	Size += size;
+
+	if (bLineBuffered) Flush();
+}
+
+void COutputBuffer::WriteBuffer()
+{
+	if (Sink) {
+		if (Size) Sink(Buffer.get(), Size);
+	}
+	else WriteAll(FileDescriptor, Buffer.get(), Size);
+	Size = 0;
+}
+
+void COutputBuffer::Flush()
+{
+	std::lock_guard<std::mutex> lock(FlushMutex);
+	WriteBuffer();
+}
+
+void COutputBuffer::FlushStandardOutputOnCrash()
+{
+	COutputBuffer* output = StandardOutput.load();
+	if (output) output->WriteBuffer();
+}
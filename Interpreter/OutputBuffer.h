@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Instruction.h"
+
+//printʽıΪÿһеʮΪÿsizeof(word_t)ֽڣֽ򣩣ȡ
+enum class EOutputFormat
+{
+	Text,
+	Binary
+};
+
+/*
+дһϴĻFlush߳ʱһϵͳд
+лģʽÿһдڽʽز鿴׼նʱĬʹл
+*/
+class COutputBuffer
+{
+private:
+	static constexpr size_t BufferSize = 1 << 20;
+	static constexpr size_t MaxNumberLength = 24;		//һıʽϻе󳤶
+
+	int FileDescriptor{ -1 };
+	std::function<void(const char*, size_t)> Sink;	//Ϊʱдݽдļ
+	EOutputFormat Format{ EOutputFormat::Text };
+	bool bLineBuffered{};
+	std::unique_ptr<char[]> Buffer;
+	size_t Size{};
+	std::mutex FlushMutex;				//forallѭгĹ߳̿߳ͬʱFlush
+
+	//деݣźŴе
+	void WriteBuffer();
+
+public:
+	//ļfileDescriptorΪ1ʱǱ׼
+	explicit COutputBuffer(int fileDescriptor = 1);
+	//sink(data, size)Ƕĳ浽ַУsinkFlushʱãᱻص
+	explicit COutputBuffer(std::function<void(const char*, size_t)> sink);
+	~COutputBuffer();
+	COutputBuffer(const COutputBuffer&) = delete;
+	COutputBuffer& operator=(const COutputBuffer&) = delete;
+
+	void SetFormat(EOutputFormat format);
+	EOutputFormat GetFormat() const;
+	void SetLineBuffered(bool lineBuffered);
+
+	//ʽдһ
+	void WriteNumber(word_t value);
+	//һʽ׷ӵoutȱ桢ٰ֮˳д
+	void AppendNumber(std::string& out, word_t value) const;
+	//дѾʽõ
+	void Write(const char* data, size_t size);
+	void Flush();
+
+	//ջźŴнǰд׼Ļе
+	static void FlushStandardOutputOnCrash();
+};
@@ -1,31 +1,309 @@
 #include "Pl0VirtualMachine.h"
 #include <fstream>
-#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include "VectorKernels.h"
 
-void Pl0VirtualMachine::Push(int32_t value)
+//ִָʱĴFail׳RunProtectedתΪ״̬
+struct SRuntimeError
+{
+	ERunStatus Status;
+	std::string Message;
+};
+
+/*
+ļļͷ֮Ϊѷ״̬ջ[0, StackPointer)õĲ
+ļеλúͳȶ뵽ҳָʱֱӳ䵽ڴ
+*/
+struct SSnapshotHeader
+{
+	uint32_t Magic;
+	uint32_t WordSize;
+	uint64_t ProgramHash;
+	uint64_t StackSize;
+	uint64_t ProgramCounter;
+	uint64_t BasePointer;
+	uint64_t StackPointer;
+	std::array<uint64_t, 4> RandomState;
+	uint64_t HeapStateSize;					//ѷ״̬ĸ
+	uint64_t StackOffset;					//ջļеλ
+	uint64_t HeapOffset;
+};
+constexpr uint32_t SnapshotMagic = 0x53304C50;	//"PL0S"
+constexpr uint64_t SnapshotPageBytes = CVirtualMemory::PageUnits * sizeof(word_t);
+
+static uint64_t RoundUpToPage(uint64_t bytes)
+{
+	return (bytes + SnapshotPageBytes - 1) / SnapshotPageBytes * SnapshotPageBytes;
+}
+
+//FNV-1a
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i{}; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001B3;
+	}
+	return hash;
+}
+
+//ִָǰջеĵԪִʱҪpopsԪ֮pushes - popsֻڼ
+static void GetStackEffect(const Instruction& instruction, uint64_t& pops, uint64_t& pushes)
+{
+	pops = pushes = 0;
+	switch (instruction.F) {
+	case INT:
+		pushes = (uword_t)instruction.a;
+		break;
+	case LIT:
+	case LOD:
+	case LBP:
+	case LOA:
+	case RAN_N:
+	case RAN:
+	case LDG:
+	case RED:
+		pushes = 1;
+		break;
+	case STO:
+	case JPC:
+	case WRT:
+	case POP:
+	case JTB:
+	case FRE:
+		pops = 1;
+		break;
+	case STO_v2:
+	case LOR:
+	case NEW:
+		pops = pushes = 1;
+		break;
+	case STR:
+	case FAL:
+		pops = 2;
+		break;
+	case STR_v2:
+	case RDA:
+		pops = 2;
+		pushes = 1;
+		break;
+	case FOR:	//תʱѭʱ3ڼʱ
+		pops = pushes = 3;
+		break;
+	case OPR:
+		pops = (instruction.a == Neg || instruction.a == Odd || instruction.a == Abs) ? 1 : 2;
+		pushes = 1;
+		break;
+	case VEC:
+		pops = (instruction.L == VecSum) ? 1 : (instruction.L == VecAdd || instruction.L == VecSub || instruction.L == VecMul) ? 3 : 2;
+		pushes = (instruction.L == VecSum || instruction.L == VecDot) ? 1 : 0;
+		break;
+	default:	//CALCAL_v2ʱջָԭJMPRETSNP
+		break;
+	}
+}
+
+/*
+鲻ŵĿִļеָʹִʱֻڴĵַ
+ϷתáתĿ궼ָУLDGĵַݶУջ֡еƫΪҲԽѵĩβ
+͸ӳڿʼÿִָǰǰջ֡еĵԪջ֡ͷ뵽ָ·޹أ㹻
+stackDepthsִвָΪuword_tֵRET鷵صջ֡
+*/
+static bool ValidateInstructions(const std::vector<Instruction>& instructions, uint64_t dataEnd, uint64_t maxOffset, std::vector<uword_t>& stackDepths, std::string& errorMessage)
+{
+	const uint64_t numInstructions = instructions.size();
+	auto fail = [&](uint64_t address, const char* message) {
+		errorMessage = "Invalid instruction " + std::to_string(address) + ": " + message;
+		return false;
+		};
+
+	//һ飺ҳӳ
+	constexpr uint64_t Unknown = std::numeric_limits<uint64_t>::max();
+	std::vector<uint64_t> depths(numInstructions, Unknown);
+	std::vector<uint64_t> entries{ 0 };
+	depths[0] = dataEnd;
+	auto addEntry = [&](uint64_t address, uint64_t headerSize) {
+		if (depths[address] == Unknown) {
+			depths[address] = headerSize;
+			entries.push_back(address);
+		}
+		return depths[address] == headerSize;
+		};
+	for (uint64_t i{}; i < numInstructions; i++) {
+		const Instruction& instruction = instructions[i];
+		int64_t target = (int64_t)i + instruction.a;
+		switch (instruction.F) {
+		case INT:
+		case RAN_N:
+			if (instruction.a < 0) return fail(i, "negative operand");
+			break;
+		case LOD:
+		case STO:
+		case STO_v2:
+		case LOA:
+			if (instruction.L > 0 || instruction.a < 0 || (uint64_t)instruction.a > maxOffset) return fail(i, "variable out of range");
+			break;
+		case FOR:
+			if (instruction.L < 0) return fail(i, "variable out of range");
+			[[fallthrough]];
+		case JMP:
+		case JPC:
+			if (target < 0 || (uint64_t)target > numInstructions) return fail(i, "jump target out of range");
+			break;
+		case CAL:
+		case CAL_v2:
+		case FAL:
+			if (instruction.a < 0 || (uint64_t)instruction.a >= numInstructions) return fail(i, "call target out of range");
+			//ջ֡ͷCALΪDLRASLCAL_v2ΪDLRAforallѭΪDLRASLѭ
+			if (!addEntry(instruction.a, instruction.F == CAL ? 3 : instruction.F == CAL_v2 ? 2 : 4)) return fail(i, "procedure called with different frame headers");
+			break;
+		case JTB:
+			if (instruction.a < 0 || (uint64_t)instruction.a >= numInstructions - i - 1) return fail(i, "jump table out of range");
+			for (uint64_t k = i + 1; k <= i + 1 + instruction.a; k++) {
+				if (instructions[k].F != JMP) return fail(i, "jump table entry is not JMP");
+			}
+			break;
+		case LDG:
+			if (instruction.a < 0 || (uint64_t)instruction.a >= dataEnd) return fail(i, "global variable out of range");
+			break;
+		case OPR:
+			if (instruction.a < Add || instruction.a > DivPow2) return fail(i, "unknown OPR code");
+			break;
+		case VEC:
+			if (instruction.L < VecCopy || instruction.L > VecDot || instruction.a < 0) return fail(i, "unknown VEC code");
+			break;
+		case LIT:
+		case RET:
+		case LOR:
+		case STR:
+		case LBP:
+		case WRT:
+		case RAN:
+		case STR_v2:
+		case POP:
+		case NEW:
+		case FRE:
+		case RED:
+		case RDA:
+		case SNP:
+			break;
+		default:	//HLTֻĩβ
+			return fail(i, "unknown instruction code");
+		}
+	}
+
+	//ڶ飺ÿе·ջеĵԪ
+	std::vector<uint64_t> pending = entries;
+	auto reach = [&](uint64_t address, uint64_t depth) {
+		if (address == numInstructions) return true;		//HLTʱִУջеĵԪ޹
+		if (depths[address] == Unknown) {
+			depths[address] = depth;
+			pending.push_back(address);
+		}
+		return depths[address] == depth;
+		};
+	while (!pending.empty()) {
+		uint64_t i = pending.back();
+		pending.pop_back();
+		const Instruction& instruction = instructions[i];
+		uint64_t depth = depths[i];
+		uint64_t pops, pushes;
+		GetStackEffect(instruction, pops, pushes);
+		if (depth < pops) return fail(i, "stack underflow");
+		if (pushes > std::numeric_limits<uword_t>::max() - (depth - pops)) return fail(i, "stack too deep");
+		uint64_t next = depth - pops + pushes;
+
+		bool consistent = true;
+		switch (instruction.F) {
+		case JMP:
+			consistent = reach(i + instruction.a, depth);
+			break;
+		case JPC:
+			consistent = reach(i + instruction.a, next) && reach(i + 1, next);
+			break;
+		case FOR:
+			consistent = reach(i + instruction.a, depth) && reach(i + 1, depth - 3);
+			break;
+		case JTB:
+			for (uint64_t k = i + 1; k <= i + 1 + instruction.a && consistent; k++) {
+				consistent = reach(k, next);
+			}
+			break;
+		case RET:
+			break;
+		default:
+			consistent = reach(i + 1, next);
+		}
+		if (!consistent) return fail(i, "inconsistent stack depth");
+	}
+
+	stackDepths.resize(numInstructions);
+	for (uint64_t i{}; i < numInstructions; i++) {
+		stackDepths[i] = depths[i] == Unknown ? std::numeric_limits<uword_t>::max() : (uword_t)depths[i];
+	}
+	return true;
+}
+
+void Pl0VirtualMachine::Push(word_t value)
 {
 	Stack[StackPointer] = value;
 	StackPointer++;
 }
 
-int32_t Pl0VirtualMachine::Pop()
+word_t Pl0VirtualMachine::Pop()
 {
 	StackPointer--;
 	return Stack[StackPointer];
 }
 
-uint32_t Pl0VirtualMachine::GetVariableAddress(int16_t levelDiff, uint32_t offset)
+word_t* Pl0VirtualMachine::PopArray(uword_t length)
+{
+	uword_t address = Pop();
+	if (address > StackSize || length > StackSize - address) {
+		Fail(ERunStatus::ArrayOutOfRange, "Array out of range: address " + std::to_string(address) + ", length " + std::to_string(length));
+	}
+	return Stack + address;
+}
+
+uword_t Pl0VirtualMachine::GetVariableAddress(int16_t levelDiff, uword_t offset)
 {
-	uint32_t basePointer = BasePointer;
+	uword_t basePointer = BasePointer;
 	while (levelDiff < 0) {
-		basePointer = Stack[basePointer + 2];
+		basePointer = GetStaticLink(basePointer);
 		levelDiff++;
 	}
 	return basePointer + offset;
 }
 
+uword_t Pl0VirtualMachine::GetStaticLink(uword_t basePointer)
+{
+	//ӳջ֡ڸ͵ĵַSLܱдʱڴ
+	uword_t staticLink = Stack[basePointer + 2];
+	if (staticLink > basePointer) [[unlikely]] FailMemoryAccess(ERunStatus::InvalidInstruction, "Corrupted static link at ", basePointer + 2);
+	return staticLink;
+}
+
+void Pl0VirtualMachine::CheckAddress(uword_t address)
+{
+	if (address >= StackSize + CVirtualMemory::PageUnits + HeapSize) [[unlikely]] {
+		FailMemoryAccess(ERunStatus::ArrayOutOfRange, "Address out of range: ", address);
+	}
+}
+
+void Pl0VirtualMachine::CheckDivisor(word_t divisor)
+{
+	if (divisor == 0) Fail(ERunStatus::DivisionByZero, "Division by zero");
+}
+
 void Pl0VirtualMachine::ExecINT(const Instruction& instruction)
 {
+	if (instruction.a > 0 && StackLimit - StackPointer < (uword_t)instruction.a) {
+		Fail(ERunStatus::StackOverflow, "Stack overflow");
+	}
 	StackPointer += instruction.a;
 }
 
@@ -36,13 +314,13 @@ void Pl0VirtualMachine::ExecLIT(const Instruction& instruction)
 
 void Pl0VirtualMachine::ExecLOD(const Instruction& instruction)
 {
-	uint32_t address = GetVariableAddress(instruction.L, instruction.a);
+	uword_t address = GetVariableAddress(instruction.L, instruction.a);
 	Push(Stack[address]);
 }
 
 void Pl0VirtualMachine::ExecSTO(const Instruction& instruction)
 {
-	uint32_t address = GetVariableAddress(instruction.L, instruction.a);
+	uword_t address = GetVariableAddress(instruction.L, instruction.a);
 	Stack[address] = Pop();
 }
 
@@ -52,7 +330,7 @@ void Pl0VirtualMachine::ExecCAL(const Instruction& instruction)
 	Push(ProgramCounter + 1);
 
 	//ҵSL
-	int32_t SL;
+	word_t SL;
 	if (instruction.L == 0) {
 		SL = Stack[BasePointer + 2];
 	}
@@ -60,10 +338,10 @@ void Pl0VirtualMachine::ExecCAL(const Instruction& instruction)
 		SL = BasePointer;
 	}
 	else {
-		int32_t levelDiff = instruction.L;
+		word_t levelDiff = instruction.L;
 		SL = BasePointer;
 		while (levelDiff < 0) {
-			SL = Stack[SL + 2];
+			SL = GetStaticLink(SL);
 			levelDiff++;
 		}
 		SL = Stack[SL + 2];
@@ -88,27 +366,29 @@ void Pl0VirtualMachine::ExecJPC(const Instruction& instruction)
 
 void Pl0VirtualMachine::ExecOPR(const Instruction& instruction)
 {
-	int32_t a, b;	//ʱ
+	word_t a, b;	//ʱ
 
 	switch (instruction.a) {
+	//ӡ˰ƣ޷ϼз
 	case Add:
-		Push(Pop() + Pop());
+		Push((word_t)((uword_t)Pop() + (uword_t)Pop()));
 		break;
 	case Sub:
 		b = Pop();
 		a = Pop();
-		Push(a - b);
+		Push((word_t)((uword_t)a - (uword_t)b));
 		break;
 	case Mul:
-		Push(Pop() * Pop());
+		Push((word_t)((uword_t)Pop() * (uword_t)Pop()));
 		break;
 	case Div:
 		b = Pop();
 		a = Pop();
-		Push(a / b);
+		CheckDivisor(b);
+		Push(b == -1 ? (word_t)(0 - (uword_t)a) : a / b);		//Сĸ-1ʱ
 		break;
 	case Neg:
-		Push(-Pop());
+		Push((word_t)(0 - (uword_t)Pop()));
 		break;
 	case LessThan:
 		b = Pop();
@@ -143,36 +423,84 @@ void Pl0VirtualMachine::ExecOPR(const Instruction& instruction)
 	case Odd:
 		Push(Pop() % 2);
 		break;
+	case Mod:
+		b = Pop();
+		a = Pop();
+		CheckDivisor(b);
+		Push(b == -1 ? 0 : a % b);
+		break;
+	case Shl:
+		b = Pop();
+		a = Pop();
+		Push((word_t)((uword_t)a << (b & (WordBits - 1))));
+		break;
+	case Shr:
+		b = Pop();
+		a = Pop();
+		Push(a >> (b & (WordBits - 1)));
+		break;
+	case And:
+		Push(Pop() & Pop());
+		break;
+	case Or:
+		Push(Pop() | Pop());
+		break;
+	case Xor:
+		Push(Pop() ^ Pop());
+		break;
+	case Min:
+		b = Pop();
+		a = Pop();
+		Push(a < b ? a : b);
+		break;
+	case Max:
+		b = Pop();
+		a = Pop();
+		Push(a > b ? a : b);
+		break;
+	case Abs:
+		a = Pop();
+		Push(a < 0 ? (word_t)(0 - (uword_t)a) : a);		//СĸľֵƣΪ
+		break;
+	case DivPow2:
+		b = Pop() & (WordBits - 1);
+		a = Pop();
+		//ǰȼ2^b-1ʹ0ȡ
+		Push((a + ((a >> (WordBits - 1)) & (word_t)(((uword_t)1 << b) - 1))) >> b);
+		break;
 	default:
-		std::cerr << "Unknown OPR code: " << instruction.a << std::endl;
-		exit(1);
+		Fail(ERunStatus::InvalidInstruction, "Unknown OPR code: " + std::to_string(instruction.a));
 	}
 }
 
 void Pl0VirtualMachine::ExecRET(const Instruction& instruction)
 {
-	uint32_t returnAddress = Stack[BasePointer + 1];
-	if (returnAddress == 0) {
-		//
-		std::cout << "========= Program finished =========" << std::endl;
-		exit(0);
+	//ķصַĩβHLTָغExecute
+	uword_t returnAddress = Stack[BasePointer + 1];
+	uword_t dynamicLink = Stack[BasePointer];
+	//DLRAܱдߵջ֡ڸ͵ĵַҴС뷵صִַָǰӦеĵԪͬ
+	if (returnAddress > HaltAddress
+		|| (returnAddress != HaltAddress && (dynamicLink > BasePointer || BasePointer - dynamicLink != StackDepths[returnAddress]))) [[unlikely]]
+	{
+		FailMemoryAccess(ERunStatus::InvalidInstruction, "Corrupted stack frame at ", BasePointer);
 	}
-
 	StackPointer = BasePointer;
 	ProgramCounter = returnAddress - 1;
-	BasePointer = Stack[BasePointer];
+	BasePointer = dynamicLink;
 }
 
 void Pl0VirtualMachine::ExecLOR(const Instruction& instruction)
 {
-	uint32_t address = Pop();
+	uword_t address = Pop();
+	CheckAddress(address);
 	Push(Stack[address]);
 }
 
 void Pl0VirtualMachine::ExecSTR(const Instruction& instruction)
 {
-	uint32_t address = Pop();
-	int32_t data = Pop();
+	uword_t address = Pop();
+	word_t data = Pop();
+	CheckAddress(address);
 	Stack[address] = data;
 }
 
@@ -183,20 +511,21 @@ void Pl0VirtualMachine::ExecLBP(const Instruction& instruction)
 
 void Pl0VirtualMachine::ExecWRT(const Instruction& instruction)
 {
-	std::cout << Pop() << std::endl;
+	if (CapturedOutput) Output->AppendNumber(*CapturedOutput, Pop());
+	else Output->WriteNumber(Pop());
 }
 
 void Pl0VirtualMachine::ExecLOA(const Instruction& instruction)
 {
-	uint32_t address = GetVariableAddress(instruction.L, instruction.a);
+	uword_t address = GetVariableAddress(instruction.L, instruction.a);
 	Push(address);
 }
 
 void Pl0VirtualMachine::ExecSTR_v2(const Instruction& instruction)
 {
-	uint32_t address = Pop();
-	int32_t data = Stack[StackPointer - 1];
-	Stack[address] = data;
+	uword_t address = Pop();
+	CheckAddress(address);
+	Stack[address] = Stack[StackPointer - 1];
 }
 
 void Pl0VirtualMachine::ExecPOP(const Instruction& instruction)
@@ -204,61 +533,728 @@ void Pl0VirtualMachine::ExecPOP(const Instruction& instruction)
 	Pop();
 }
 
+void Pl0VirtualMachine::ExecCAL_v2(const Instruction& instruction)
+{
+	//õӳҪ̬ջ֡ͷֻDLRA
+	Push(BasePointer);
+	Push(ProgramCounter + 1);
+	BasePointer = StackPointer - 2;
+	ProgramCounter = instruction.a - 1;
+}
+
+void Pl0VirtualMachine::ExecLDG(const Instruction& instruction)
+{
+	//ջ֡0ʼȫֱƫԵַ
+	Push(Stack[instruction.a]);
+}
+
+void Pl0VirtualMachine::ExecSTO_v2(const Instruction& instruction)
+{
+	uword_t address = GetVariableAddress(instruction.L, instruction.a);
+	Stack[address] = Stack[StackPointer - 1];
+}
+
+void Pl0VirtualMachine::ExecFOR(const Instruction& instruction)
+{
+	/*
+	սѭʱջΪֵֵѳֵѭδԽֵʱѲƵֵλáջΪ0Ȼѭ
+	֮ջΪ0ֵѭϲδԽֵʱѭ壻֤Ϊ0
+	ӷuword_tнУֳķΧʱѭֲ䲢ѭ
+	*/
+	word_t limit = Stack[StackPointer - 2];
+	word_t& variable = Stack[BasePointer + instruction.L];
+	word_t step;
+	if (Stack[StackPointer - 1] != 0) {
+		step = Stack[StackPointer - 1];
+		variable = Stack[StackPointer - 3];
+		Stack[StackPointer - 3] = step;
+		Stack[StackPointer - 1] = 0;
+	}
+	else {
+		step = Stack[StackPointer - 3];
+		word_t next = (word_t)((uword_t)variable + (uword_t)step);
+		if (step > 0 ? next < variable : next > variable) {
+			StackPointer -= 3;
+			return;
+		}
+		variable = next;
+	}
+
+	if (step > 0 ? variable <= limit : variable >= limit) {
+		ProgramCounter += instruction.a - 1;
+	}
+	else {
+		StackPointer -= 3;
+	}
+}
+
+void Pl0VirtualMachine::ExecJTB(const Instruction& instruction)
+{
+	uword_t index = (uword_t)Pop();
+	if (index > (uword_t)instruction.a) index = instruction.a;
+
+	//ֱӰJMPָƫתִб
+	uint32_t entry = ProgramCounter + 1 + index;
+	ProgramCounter = entry + Instructions[entry].a - 1;
+}
+
+void Pl0VirtualMachine::ExecVEC(const Instruction& instruction)
+{
+	uword_t length = instruction.a;
+	word_t value;
+	word_t* dst, * a, * b;	//ʱ
+
+	switch (instruction.L) {
+	case VecCopy:
+		a = PopArray(length);
+		dst = PopArray(length);
+		VectorCopy(dst, a, length);
+		break;
+	case VecFill:
+		value = Pop();
+		dst = PopArray(length);
+		VectorFill(dst, value, length);
+		break;
+	case VecAdd:
+	case VecSub:
+	case VecMul:
+		b = PopArray(length);
+		a = PopArray(length);
+		dst = PopArray(length);
+		if (instruction.L == VecAdd) VectorAdd(dst, a, b, length);
+		else if (instruction.L == VecSub) VectorSub(dst, a, b, length);
+		else VectorMul(dst, a, b, length);
+		break;
+	case VecSum:
+		a = PopArray(length);
+		Push(VectorSum(a, length));
+		break;
+	case VecDot:
+		b = PopArray(length);
+		a = PopArray(length);
+		Push(VectorDot(a, b, length));
+		break;
+	default:
+		Fail(ERunStatus::InvalidInstruction, "Unknown VEC code: " + std::to_string(instruction.L));
+	}
+}
+
+void Pl0VirtualMachine::RunForallBody(uint32_t entry, uword_t staticLink, word_t index, uint64_t seed)
+{
+	if (ForallDepth >= MaxForallDepth) [[unlikely]] {
+		Fail(ERunStatus::StackOverflow, "Stack overflow: forall loops nested too deeply");
+	}
+	uint32_t programCounter = ProgramCounter;
+	uword_t basePointer = BasePointer;
+	uword_t stackPointer = StackPointer;
+	CRandom random = Random;
+
+	//ѭ巵صHLTָʱRun()
+	BasePointer = StackPointer;
+	Push(basePointer);
+	Push(HaltAddress);
+	Push(staticLink);
+	Push(index);
+	ProgramCounter = entry;
+	Random = CRandom::ForStream(seed, (uint64_t)index);
+	ForallDepth++;
+	if (Profiler) {
+		Profiler->OnCall(entry);
+		Execute<false, true>(0);
+	}
+	else {
+		Execute<false, false>(0);
+	}
+	ForallDepth--;
+
+	ProgramCounter = programCounter;
+	BasePointer = basePointer;
+	StackPointer = stackPointer;
+	Random = random;
+}
+
+void Pl0VirtualMachine::ExecFAL(const Instruction& instruction)
+{
+	word_t limit = Pop();
+	word_t start = Pop();
+	if (start > limit) return;
+	uint64_t count = (uint64_t)limit - (uint64_t)start + 1;
+	uint64_t seed = Random.Next();
+	uword_t staticLink = BasePointer;		//ѭǵǰӳӳ
+
+	//Ƕ׵forallѭֻһ߳ʱԼܷʱֱִ
+	if (bIsWorker || NumThreads <= 1 || count == 1 || Profiler) {
+		for (word_t index = start; ; index++) {
+			RunForallBody(instruction.a, staticLink, index, seed);
+			if (index == limit) break;
+		}
+		return;
+	}
+
+	if (!ThreadPool) {
+		/*
+		ջλջÿβ16MԪҼܵջռһ룻ÿεĿͷһҳ
+		֮ջٽⲿ֣ջѾõջ̫Сʱִֻ
+		*/
+		constexpr uword_t PageUnits = CVirtualMemory::PageUnits;
+		uword_t segmentSize = std::min<uword_t>(16 * 1024 * 1024, StackSize / 2 / NumThreads) / PageUnits * PageUnits;
+		uword_t workersBase = StackSize - NumThreads * segmentSize;
+		if (segmentSize < 2 * PageUnits || StackPointer > workersBase) {
+			for (int64_t index = start; index <= limit; index++) {
+				RunForallBody(instruction.a, staticLink, (word_t)index, seed);
+			}
+			return;
+		}
+
+		ThreadPool = std::make_unique<CWorkStealingPool>(NumThreads);
+		for (uint32_t i{}; i < NumThreads; i++) {
+			uword_t segmentBase = workersBase + i * segmentSize;
+			Memory->AddGuardPage(segmentBase);
+			Workers.push_back(std::unique_ptr<Pl0VirtualMachine>(new Pl0VirtualMachine(*this, segmentBase + PageUnits, segmentBase + segmentSize)));
+		}
+		StackLimit = workersBase;
+	}
+
+	//ֳɿ飬ÿ棬ȫִ˳
+	uint32_t numChunks = (uint32_t)std::min<uint64_t>(count, NumThreads * 8);
+	std::vector<std::string> outputs(numChunks);
+	//ĳ̳̲߳߳ٿʼµĵȷĴѾȫ
+	std::atomic<bool> failed{};
+	std::mutex errorMutex;
+	ERunStatus errorStatus{};
+	std::string errorMessage;
+	ThreadPool->Run(numChunks, [&](uint32_t chunk, uint32_t workerIndex) {
+		Pl0VirtualMachine& worker = *Workers[workerIndex];
+		worker.CapturedOutput = &outputs[chunk];
+		uint64_t begin = count * chunk / numChunks;
+		uint64_t end = count * (chunk + 1) / numChunks;
+		bool succeeded = worker.RunProtected([&] {
+			for (uint64_t i = begin; i < end && !failed.load(std::memory_order_relaxed); i++) {
+				worker.RunForallBody(instruction.a, staticLink, (word_t)((uint64_t)start + i), seed);
+			}
+			});
+		worker.CapturedOutput = nullptr;
+		if (!succeeded) {
+			//ʱRunForallBodyûлָĴ
+			worker.ProgramCounter = 0;
+			worker.StackPointer = worker.BasePointer = worker.StackBase;
+			worker.ForallDepth = 0;
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if (!failed.exchange(true)) {
+				errorStatus = worker.Status;
+				errorMessage = worker.ErrorMessage;
+			}
+		}
+		});
+	if (failed) Fail(errorStatus, errorMessage);
+
+	for (auto& output : outputs) {
+		if (CapturedOutput) CapturedOutput->append(output);
+		else Output->Write(output.data(), output.size());
+	}
+}
+
+void Pl0VirtualMachine::ExecNEW(const Instruction& instruction)
+{
+	word_t size = Pop();
+	if (size < 0) Fail(ERunStatus::InvalidArgument, "Negative size passed to new: " + std::to_string(size));
+	uword_t address = Heap->Allocate(size);
+	if (!address) Fail(ERunStatus::OutOfMemory, "Out of heap memory when allocating " + std::to_string(size) + " units");
+	Push(address);
+}
+
+void Pl0VirtualMachine::ExecFRE(const Instruction& instruction)
+{
+	uword_t address = Pop();
+	if (!Heap->Free(address)) Fail(ERunStatus::InvalidPointer, "Invalid pointer passed to free: " + std::to_string(address));
+}
+
+void Pl0VirtualMachine::CheckReadStatus(EReadStatus status)
+{
+	if (status == EReadStatus::Ok) return;
+	if (status == EReadStatus::End) Fail(ERunStatus::InputError, "Unexpected end of input");
+	if (status == EReadStatus::OutOfRange) Fail(ERunStatus::InputError, "Input number out of range");
+	Fail(ERunStatus::InputError, "Invalid input");
+}
+
+void Pl0VirtualMachine::ExecRED(const Instruction& instruction)
+{
+	word_t value;
+	CheckReadStatus(Input->Read(value));
+	Push(value);
+}
+
+void Pl0VirtualMachine::ExecRDA(const Instruction& instruction)
+{
+	word_t n = Pop();
+	if (n < 0 || n > instruction.a) {
+		Fail(ERunStatus::InvalidArgument, "readarray count out of range: " + std::to_string(n) + ", array size " + std::to_string(instruction.a));
+	}
+	word_t* dst = PopArray(instruction.a);
+	uword_t count;
+	CheckReadStatus(Input->ReadArray(dst, n, count));
+	Push(count);
+}
+
+void Pl0VirtualMachine::ExecSNP(const Instruction& instruction)
+{
+	//forallѭĵйļĴ״̬
+	if (bIsWorker || SnapshotFile.empty()) return;
+
+	//ӿջָһָ
+	ProgramCounter++;
+	std::string errorMessage;
+	bool saved = SaveSnapshot(SnapshotFile, errorMessage);
+	ProgramCounter--;
+	if (!saved) Fail(ERunStatus::SnapshotError, errorMessage);
+}
+
 void Pl0VirtualMachine::ExecRAN_N(const Instruction& instruction)
 {
-	uint32_t num = instruction.a;
-	num = mt() % num;
-	Push(num);
+	Push((word_t)Random.Bounded((uword_t)instruction.a));
 
 }
 void Pl0VirtualMachine::ExecRAN(const Instruction& instruction)
 {
-	uint32_t num = mt() % 2000000000;
+	Push((word_t)Random.Bounded(2000000000));
+}
 
-	Push(num);
+Pl0VirtualMachine::Pl0VirtualMachine(Pl0VirtualMachine& parent, uword_t stackBase, uword_t stackLimit)
+	: Status(ERunStatus::Ready), Program(parent.Program), Instructions(parent.Instructions), HaltAddress(parent.HaltAddress), StackDepths(parent.StackDepths), MaxStackSize(parent.MaxStackSize),
+	BasePointer(stackBase), StackPointer(stackBase), Stack(parent.Stack), StackSize(parent.StackSize), StackLimit(stackLimit), StackBase(stackBase),
+	Heap(parent.Heap), Output(parent.Output), Input(parent.Input), NumThreads(1), bIsWorker(true), Random(0)
+{
+}
+
+Pl0VirtualMachine::Pl0VirtualMachine(uword_t maxStackSize) : MaxStackSize(maxStackSize)
+{
+	NumThreads = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+	Output = std::make_shared<COutputBuffer>();
+	Input = std::make_shared<CInputReader>(EInputFormat::Text);
+}
+
+Pl0VirtualMachine::~Pl0VirtualMachine() = default;
+
+void Pl0VirtualMachine::SetNumThreads(uint32_t numThreads)
+{
+	NumThreads = std::max<uint32_t>(numThreads, 1);
+}
+
+void Pl0VirtualMachine::SetSeed(uint64_t seed)
+{
+	bHasSeed = true;
+	Seed = seed;
+	Random = CRandom(seed);
 }
 
-Pl0VirtualMachine::Pl0VirtualMachine(const std::string& executableFile) : Stack(1024 * 1024), Instructions{}
+void Pl0VirtualMachine::SetOutput(std::shared_ptr<COutputBuffer> output)
+{
+	Output = std::move(output);
+	for (auto& worker : Workers) {
+		worker->Output = Output;
+	}
+}
+
+void Pl0VirtualMachine::SetInput(std::shared_ptr<CInputReader> input)
+{
+	Input = std::move(input);
+	for (auto& worker : Workers) {
+		worker->Input = Input;
+	}
+}
+
+void Pl0VirtualMachine::PrintHeapStats(std::ostream& out)
+{
+	if (Heap) Heap->PrintStats(out);
+}
+
+const char* GetRunStatusName(ERunStatus status)
+{
+	switch (status) {
+	case ERunStatus::NotLoaded: return "NotLoaded";
+	case ERunStatus::Ready: return "Ready";
+	case ERunStatus::Suspended: return "Suspended";
+	case ERunStatus::Finished: return "Finished";
+	case ERunStatus::InvalidExecutable: return "InvalidExecutable";
+	case ERunStatus::OutOfMemory: return "OutOfMemory";
+	case ERunStatus::StackOverflow: return "StackOverflow";
+	case ERunStatus::DivisionByZero: return "DivisionByZero";
+	case ERunStatus::ArrayOutOfRange: return "ArrayOutOfRange";
+	case ERunStatus::InvalidArgument: return "InvalidArgument";
+	case ERunStatus::InvalidPointer: return "InvalidPointer";
+	case ERunStatus::InputError: return "InputError";
+	case ERunStatus::InvalidInstruction: return "InvalidInstruction";
+	case ERunStatus::SnapshotError: return "SnapshotError";
+	}
+	return "Unknown";
+}
+
+ERunStatus Pl0VirtualMachine::GetStatus() const
+{
+	return Status;
+}
+
+const std::string& Pl0VirtualMachine::GetErrorMessage() const
+{
+	return ErrorMessage;
+}
+
+bool Pl0VirtualMachine::FailToLoad(ERunStatus status, const std::string& message)
+{
+	Status = status;
+	ErrorMessage = message;
+	return false;
+}
+
+std::shared_ptr<const SProgram> Pl0VirtualMachine::ReadProgram(const std::string& executableFile, std::string& errorMessage)
 {
 	std::ifstream file(executableFile, std::ios::binary);
-	if (!file.is_open())
-	{
-		std::cerr << "Cannot open file: " << executableFile << std::endl;
-		exit(1);
+	if (!file.is_open()) {
+		errorMessage = "Cannot open file: " + executableFile;
+		return nullptr;
 	}
 
-	// ȡļС
-	size_t fileSize;
 	file.seekg(0, std::ios::end);
-	fileSize = file.tellg();
-	if (fileSize % sizeof(Instruction) != 0)
+	std::string content((size_t)file.tellg(), '\0');
+	file.seekg(0, std::ios::beg);
+	file.read(content.data(), content.size());
+	if (!file) {
+		errorMessage = "Cannot read file: " + executableFile;
+		return nullptr;
+	}
+	return ReadProgram(content.data(), content.size(), errorMessage);
+}
+
+std::shared_ptr<const SProgram> Pl0VirtualMachine::ReadProgram(const void* data, size_t size, std::string& errorMessage)
+{
+	//ȡļͷ
+	const char* bytes = (const char*)data;
+	SExecutableHeader header{};
+	if (size >= sizeof(header)) std::memcpy(&header, bytes, sizeof(header));
+	if (header.Magic == ExecutableMagic && (header.WordSize == 4 || header.WordSize == 8) && header.WordSize != sizeof(word_t)) {
+		errorMessage = "The executable uses " + std::to_string(header.WordSize * 8) + "-bit words, but this interpreter uses " + std::to_string(WordBits) + "-bit words";
+		return nullptr;
+	}
+	if (header.Magic != ExecutableMagic || header.DataAddress < 3 || header.DataAddress > std::numeric_limits<uword_t>::max()
+		|| header.NumInstructions > size / sizeof(Instruction) || header.DataSize > size / sizeof(word_t)
+		|| size != sizeof(header) + header.NumInstructions * sizeof(Instruction) + header.DataSize * sizeof(word_t))
 	{
-		std::cerr << "File size error" << std::endl;
-		exit(1);
+		errorMessage = "File format error";
+		return nullptr;
 	}
 
-	//ȡָ
-	uint32_t nInstructions = fileSize / sizeof(Instruction);
+	//ȡָݶ
+	std::vector<Instruction> instructions(header.NumInstructions);
+	std::memcpy(instructions.data(), bytes + sizeof(header), header.NumInstructions * sizeof(Instruction));
+	std::vector<word_t> programData(header.DataSize);
+	std::memcpy(programData.data(), bytes + sizeof(header) + header.NumInstructions * sizeof(Instruction), header.DataSize * sizeof(word_t));
+	return CreateProgram(std::move(instructions), (uword_t)header.DataAddress, std::move(programData), errorMessage);
+}
+
+std::shared_ptr<const SProgram> Pl0VirtualMachine::CreateProgram(std::vector<Instruction> instructions, uword_t dataAddress, std::vector<word_t> data, std::string& errorMessage)
+{
+	//ջ֡ջеĳʼƫѵĴСʱƫջҳͶ֮
+	auto program = std::make_shared<SProgram>();
+	if ((uint64_t)dataAddress + data.size() > std::numeric_limits<uword_t>::max()
+		|| !ValidateInstructions(instructions, (uint64_t)dataAddress + data.size(), HeapSize, program->StackDepths, errorMessage))
+	{
+		return nullptr;
+	}
+
+	program->Instructions = std::move(instructions);
+	program->Instructions.push_back({ HLT,0,0 });
+	program->DataAddress = dataAddress;
+	program->Data = std::move(data);
+	//ֶμ㣬64λģʽָеֽڲһͬ
+	uint64_t hash = 0xCBF29CE484222325;
+	for (const Instruction& instruction : program->Instructions) {
+		hash = HashBytes(hash, &instruction.F, sizeof(instruction.F));
+		hash = HashBytes(hash, &instruction.L, sizeof(instruction.L));
+		hash = HashBytes(hash, &instruction.a, sizeof(instruction.a));
+	}
+	program->Hash = HashBytes(hash, program->Data.data(), program->Data.size() * sizeof(word_t));
+	return program;
+}
+
+bool Pl0VirtualMachine::Load(const std::string& executableFile)
+{
+	std::string errorMessage;
+	std::shared_ptr<const SProgram> program = ReadProgram(executableFile, errorMessage);
+	if (!program) return FailToLoad(ERunStatus::InvalidExecutable, errorMessage);
+	return Load(std::move(program));
+}
+
+bool Pl0VirtualMachine::Load(const void* data, size_t size)
+{
+	std::string errorMessage;
+	std::shared_ptr<const SProgram> program = ReadProgram(data, size, errorMessage);
+	if (!program) return FailToLoad(ERunStatus::InvalidExecutable, errorMessage);
+	return Load(std::move(program));
+}
+
+bool Pl0VirtualMachine::Load(std::shared_ptr<const SProgram> program)
+{
+	//ݶηջףռ֮ջռ䣻32λģʽµַ32λģջҳͶѼܳ4GԪ
+	constexpr uword_t PageUnits = CVirtualMemory::PageUnits;
+	uint64_t dataEnd = (uint64_t)program->DataAddress + program->Data.size();
+	uint64_t stackSize = (dataEnd + MaxStackSize + PageUnits - 1) / PageUnits * PageUnits;
+	if (stackSize + PageUnits + HeapSize > std::numeric_limits<uword_t>::max()) {
+		return FailToLoad(ERunStatus::OutOfMemory, "Stack size too large");
+	}
+
+	//Ѿڴ湻ʱʹã±ԭĹʹõǾɵڴ棬һ
+	if (!Memory || StackSize < stackSize) {
+		Workers.clear();
+		ThreadPool.reset();
+		Heap.reset();
+		Memory.reset();
+		Stack = nullptr;
+
+		size_t numUnits = (size_t)stackSize + PageUnits + HeapSize;
+		auto memory = std::make_unique<CVirtualMemory>(numUnits);
+		if (!memory->GetData()) {
+			return FailToLoad(ERunStatus::OutOfMemory, "Cannot reserve " + std::to_string(numUnits * sizeof(word_t) / (1024 * 1024)) + " MB of memory");
+		}
+		Memory = std::move(memory);
+		StackSize = StackLimit = (uword_t)stackSize;
+		Memory->AddGuardPage(StackSize);
+		Stack = Memory->GetData();
+		Heap = std::make_shared<CHeapAllocator>(Stack, StackSize + PageUnits, HeapSize);
+		bMemoryUsed = false;
+	}
+
+	Program = std::move(program);
+	Instructions = Program->Instructions.data();
+	StackDepths = Program->StackDepths.data();
+	Profiler.reset();
+	HaltAddress = (uint32_t)Program->Instructions.size() - 1;
+	for (auto& worker : Workers) {
+		worker->Program = Program;
+		worker->Instructions = Instructions;
+		worker->HaltAddress = HaltAddress;
+		worker->StackDepths = StackDepths;
+	}
+	Reset();
+	return true;
+}
+
+void Pl0VirtualMachine::Reset()
+{
+	if (!Program) return;
+
+	if (bMemoryUsed) {
+		Memory->Clear();
+		bMemoryUsed = false;
+	}
+	Heap->Reset();
+
+	//ջ֡ͷDLSLΪ0صַΪĩβHLTָݶֱӷջ֡
+	Stack[0] = 0;
+	Stack[1] = HaltAddress;
+	Stack[2] = 0;
+	std::copy(Program->Data.begin(), Program->Data.end(), Stack + Program->DataAddress);
+	ProgramCounter = 0;
+	BasePointer = 0;
+	StackPointer = Program->DataAddress + (uword_t)Program->Data.size();
+	ForallDepth = 0;
+
+	Random = bHasSeed ? CRandom(Seed) : CRandom();
+	if (Profiler) Profiler->Reset();
+	Status = ERunStatus::Ready;
+	ErrorMessage.clear();
+}
+
+ERunStatus Pl0VirtualMachine::Run()
+{
+	if (Status != ERunStatus::Ready && Status != ERunStatus::Suspended) return Status;
+
+	bMemoryUsed = true;
+	if (Profiler) {
+		Profiler->Resume();
+		if (RunProtected([this] { Execute<false, true>(0); })) Status = ERunStatus::Finished;
+		Profiler->Pause();
+	}
+	else if (RunProtected([this] { Execute<false, false>(0); })) {
+		Status = ERunStatus::Finished;
+	}
+	Output->Flush();
+	return Status;
+}
+
+ERunStatus Pl0VirtualMachine::RunFor(uint64_t numInstructions)
+{
+	if (Status != ERunStatus::Ready && Status != ERunStatus::Suspended) return Status;
+
+	bMemoryUsed = true;
+	bool halted{};
+	if (Profiler) Profiler->Resume();
+	bool succeeded = Profiler ? RunProtected([&] { halted = Execute<true, true>(numInstructions); })
+		: RunProtected([&] { halted = Execute<true, false>(numInstructions); });
+	if (Profiler) Profiler->Pause();
+	if (succeeded) Status = halted ? ERunStatus::Finished : ERunStatus::Suspended;
+	Output->Flush();
+	return Status;
+}
+
+void Pl0VirtualMachine::SetSnapshotFile(const std::string& snapshotFile)
+{
+	SnapshotFile = snapshotFile;
+}
+
+void Pl0VirtualMachine::EnableProfiling(std::shared_ptr<const SSymbolTable> symbols)
+{
+	if (!Program) return;
+	Profiler = std::make_unique<CProfiler>(Program->Instructions.size(), std::move(symbols));
+}
+
+const CProfiler* Pl0VirtualMachine::GetProfiler() const
+{
+	return Profiler.get();
+}
+
+bool Pl0VirtualMachine::SaveSnapshot(const std::string& snapshotFile, std::string& errorMessage)
+{
+	if (Status != ERunStatus::Ready && Status != ERunStatus::Suspended) {
+		errorMessage = "Cannot save a snapshot when the program is not running";
+		return false;
+	}
+	//֮ǰڿգдָһ
+	Output->Flush();
+
+	std::vector<uint64_t> heapState = Heap->SaveState();
+	uword_t heapBase = Heap->GetBase();
+	uword_t heapTop = (uword_t)heapState[0];
+	SSnapshotHeader header{ SnapshotMagic,sizeof(word_t),Program->Hash,StackSize,ProgramCounter,BasePointer,StackPointer,Random.GetState(),heapState.size() };
+	header.StackOffset = RoundUpToPage(sizeof(header) + heapState.size() * sizeof(uint64_t));
+	header.HeapOffset = header.StackOffset + RoundUpToPage((uint64_t)StackPointer * sizeof(word_t));
+	uint64_t fileSize = header.HeapOffset + RoundUpToPage((uint64_t)(heapTop - heapBase) * sizeof(word_t));
+
+	//дʱļٸʹþɵĿյӰ
+	std::string temporaryFile = snapshotFile + ".tmp";
+	{
+		std::ofstream file(temporaryFile, std::ios::binary | std::ios::trunc);
+		//ÿһ֮0һҳĿͷһҳҲҪļУӳļĩβ֮Ĳֻ
+		const std::vector<char> zeros(SnapshotPageBytes);
+		auto padTo = [&](uint64_t offset) {
+			uint64_t position = (uint64_t)file.tellp();
+			if (position < offset) file.write(zeros.data(), (size_t)(offset - position));
+			};
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)heapState.data(), heapState.size() * sizeof(uint64_t));
+		padTo(header.StackOffset);
+		file.write((const char*)Stack, (size_t)StackPointer * sizeof(word_t));
+		padTo(header.HeapOffset);
+		file.write((const char*)(Stack + heapBase), (size_t)(heapTop - heapBase) * sizeof(word_t));
+		padTo(fileSize);
+		file.close();
+		if (!file) {
+			std::filesystem::remove(temporaryFile);
+			errorMessage = "Cannot write snapshot file: " + snapshotFile;
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporaryFile, snapshotFile, error);
+	if (error) {
+		std::filesystem::remove(temporaryFile, error);
+		errorMessage = "Cannot write snapshot file: " + snapshotFile;
+		return false;
+	}
+	return true;
+}
+
+bool Pl0VirtualMachine::RestoreSnapshot(const std::string& snapshotFile)
+{
+	if (!Program) return FailToLoad(ERunStatus::NotLoaded, "No program loaded");
+
+	std::ifstream file(snapshotFile, std::ios::binary);
+	if (!file.is_open()) return FailToLoad(ERunStatus::SnapshotError, "Cannot open snapshot file: " + snapshotFile);
+	file.seekg(0, std::ios::end);
+	uint64_t fileSize = (uint64_t)file.tellg();
 	file.seekg(0, std::ios::beg);
-	for (uint32_t i{}; i < nInstructions; i++)
+
+	SSnapshotHeader header{};
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.Magic != SnapshotMagic || header.WordSize != sizeof(word_t) || header.HeapStateSize > fileSize / sizeof(uint64_t)) {
+		return FailToLoad(ERunStatus::SnapshotError, "Snapshot file format error");
+	}
+	std::vector<uint64_t> heapState(header.HeapStateSize);
+	file.read((char*)heapState.data(), heapState.size() * sizeof(uint64_t));
+	if (!file) return FailToLoad(ERunStatus::SnapshotError, "Snapshot file format error");
+	if (header.ProgramHash != Program->Hash) return FailToLoad(ERunStatus::SnapshotError, "The snapshot was taken from a different program");
+	if (header.StackSize != StackSize) return FailToLoad(ERunStatus::SnapshotError, "The snapshot was taken with a different maximum stack size");
+
+	uint64_t stackBytes = RoundUpToPage(header.StackPointer * sizeof(word_t));
+	if (header.StackPointer > StackLimit || header.BasePointer >= header.StackPointer || header.ProgramCounter >= HaltAddress
+		|| header.StackPointer - header.BasePointer != StackDepths[header.ProgramCounter]
+		|| header.StackOffset % SnapshotPageBytes != 0 || header.StackOffset > fileSize || stackBytes > fileSize - header.StackOffset
+		|| header.HeapOffset % SnapshotPageBytes != 0 || header.HeapOffset > fileSize || !Heap->RestoreState(heapState))
+	{
+		return FailToLoad(ERunStatus::SnapshotError, "Snapshot file format error");
+	}
+	uword_t heapBase = Heap->GetBase();
+	uint64_t heapBytes = RoundUpToPage((uint64_t)(Heap->GetTop() - heapBase) * sizeof(word_t));
+
+	//ȫ0ڴ濪ʼӳеΣʧʱڴݲȷReset
+	if (bMemoryUsed) Memory->Clear();
+	bMemoryUsed = true;
+	if (heapBytes > fileSize - header.HeapOffset
+		|| !Memory->MapFile(snapshotFile, header.StackOffset, 0, (uword_t)(stackBytes / sizeof(word_t)))
+		|| !Memory->MapFile(snapshotFile, header.HeapOffset, heapBase, (uword_t)(heapBytes / sizeof(word_t))))
 	{
-		Instruction instruction;
-		file.read((char*)&instruction, sizeof(Instruction));
-		Instructions.push_back(instruction);
+		return FailToLoad(ERunStatus::SnapshotError, "Cannot map snapshot file: " + snapshotFile);
 	}
 
-	//ΪԤѹ0ռDLRASLλ
-	Push(0);
-	Push(0);
-	Push(0);
+	ProgramCounter = (uint32_t)header.ProgramCounter;
+	BasePointer = (uword_t)header.BasePointer;
+	StackPointer = (uword_t)header.StackPointer;
+	ForallDepth = 0;
+	Random.SetState(header.RandomState);
+	if (Profiler) Profiler->Reset();
+	Status = ERunStatus::Suspended;
+	ErrorMessage.clear();
+	return true;
+}
+
+void Pl0VirtualMachine::Fail(ERunStatus status, const std::string& message)
+{
+	throw SRuntimeError{ status,message };
+}
+
+void Pl0VirtualMachine::FailMemoryAccess(ERunStatus status, const char* message, uword_t address)
+{
+	Fail(status, message + std::to_string(address));
 }
 
-void Pl0VirtualMachine::Run()
+bool Pl0VirtualMachine::RunProtected(const std::function<void()>& function)
+{
+	try {
+		if (CVirtualMemory::RunGuarded(function)) return true;
+		Status = ERunStatus::StackOverflow;
+		ErrorMessage = "Stack overflow";
+	}
+	catch (const SRuntimeError& error) {
+		Status = error.Status;
+		ErrorMessage = error.Message;
+	}
+	return false;
+}
+
+template <bool bLimited, bool bProfiled>
+bool Pl0VirtualMachine::Execute(uint64_t budget)
 {
 	Instruction instruction;
 
 	while (true) {
+		//ProgramCounterʱָһҪִеָﷵغֱӼ
+		if constexpr (bLimited) {
+			if (budget == 0) return false;
+			budget--;
+		}
 		instruction = Instructions[ProgramCounter];
+		if constexpr (bProfiled) {
+			if (instruction.F != HLT) Profiler->OnInstruction(ProgramCounter);
+		}
 
 		switch (instruction.F) {
 		case INT:
@@ -275,6 +1271,7 @@ void Pl0VirtualMachine::Run()
 			break;
 		case CAL:
 			ExecCAL(instruction);
+			if constexpr (bProfiled) Profiler->OnCall((uint32_t)instruction.a);
 			break;
 		case JMP:
 			ExecJMP(instruction);
@@ -287,6 +1284,7 @@ void Pl0VirtualMachine::Run()
 			break;
 		case RET:
 			ExecRET(instruction);
+			if constexpr (bProfiled) Profiler->OnReturn();
 			break;
 		case LOR:
 			ExecLOR(instruction);
@@ -315,9 +1313,47 @@ void Pl0VirtualMachine::Run()
 		case POP:
 			ExecPOP(instruction);
 			break;
+		case CAL_v2:
+			ExecCAL_v2(instruction);
+			if constexpr (bProfiled) Profiler->OnCall((uint32_t)instruction.a);
+			break;
+		case LDG:
+			ExecLDG(instruction);
+			break;
+		case STO_v2:
+			ExecSTO_v2(instruction);
+			break;
+		case FOR:
+			ExecFOR(instruction);
+			break;
+		case JTB:
+			ExecJTB(instruction);
+			break;
+		case VEC:
+			ExecVEC(instruction);
+			break;
+		case FAL:
+			ExecFAL(instruction);
+			break;
+		case HLT:
+			return true;
+		case NEW:
+			ExecNEW(instruction);
+			break;
+		case FRE:
+			ExecFRE(instruction);
+			break;
+		case RED:
+			ExecRED(instruction);
+			break;
+		case RDA:
+			ExecRDA(instruction);
+			break;
+		case SNP:
+			ExecSNP(instruction);
+			break;
 		default:
-			std::cerr << "Unknown instruction code: " << instruction.F << std::endl;
-			exit(1);
+			Fail(ERunStatus::InvalidInstruction, "Unknown instruction code: " + std::to_string(instruction.F));
 		}
 
 		ProgramCounter++;
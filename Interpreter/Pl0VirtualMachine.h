@@ -1,24 +1,137 @@
 #pragma once
 #include <vector>
 #include <string>
-#include <random>
+#include <memory>
+#include <functional>
+#include <ostream>
 #include "Instruction.h"
+#include "Executable.h"
+#include "WorkStealingPool.h"
+#include "HeapAllocator.h"
+#include "VirtualMemory.h"
+#include "OutputBuffer.h"
+#include "InputReader.h"
+#include "Random.h"
+#include "Profiler.h"
 
+//״̬ҲRunĽ
+enum class ERunStatus
+{
+	NotLoaded,				//ûгɹ
+	Ready,					//Ѿ򣬿Run
+	Suspended,				//RunForִ˸ָûнԼRunRunFor
+	Finished,				//
+	//ΪGetErrorMessage()Ϣ
+	InvalidExecutable,		//ִļܴ򿪻߸ʽ
+	OutOfMemory,			//ܱڴ棬߶ѿռ䲻
+	StackOverflow,
+	DivisionByZero,
+	ArrayOutOfRange,
+	InvalidArgument,		//newĴСΪreadarrayĸĴС
+	InvalidPointer,			//freeĵַЧ
+	InputError,				//readreadarray߸ʽ
+	InvalidInstruction,		//δ֪Ĳ룬ջ֡ͷDLRASLд
+	SnapshotError			//ļд롢ȡ߲ڵǰĳ
+};
+
+//״̬֣"DivisionByZero"
+const char* GetRunStatusName(ERunStatus status);
+
+//ĳֻɶ
+struct SProgram
+{
+	std::vector<Instruction> Instructions;	//ĩβһHLTָ
+	uword_t DataAddress;
+	std::vector<word_t> Data;				//ݶΣResetʱƵջ֡
+	std::vector<uword_t> StackDepths;		//ÿִָǰǰջ֡еĵԪִвָΪuword_tֵRET鷵صջ֡
+	uint64_t Hash{};						//ָݶεĹϣڼǷ
+};
+
+/*
+PL/0ǶʹãRun߳ʱأ
+ResetٴִͬһLoadһҲҪ±ڴ棨Ҫջһִкܶ
+*/
 class Pl0VirtualMachine
 {
 private:
+	ERunStatus Status{ ERunStatus::NotLoaded };
+	std::string ErrorMessage;
+	std::shared_ptr<const SProgram> Program;
+	const Instruction* Instructions{};		//Program->Instructions.data()
+	uint32_t HaltAddress{};					//ָĩβHLTָĵַҲķصַ
+	const uword_t* StackDepths{};			//Program->StackDepths.data()
+
+	uword_t MaxStackSize;
 	uint32_t ProgramCounter{};
-	uint32_t BasePointer{};
-	uint32_t StackPointer{};
-	std::vector<int32_t> Stack;
-	std::vector<Instruction> Instructions;
+	uword_t BasePointer{};
+	uword_t StackPointer{};
+	/*
+	ڴΪջջ׵ݶΣһҳѣֻԤַռ䣬ʱŷڴ
+	ִforallѭĹڴ棬ֻӵ
+	*/
+	std::unique_ptr<CVirtualMemory> Memory;
+	word_t* Stack{};
+	uword_t StackSize{};					//ջĴСջ׵ݶ
+	uword_t StackLimit{};					//ջܳĵַ֮ǱҳINTһηܶ൥Ԫʱҳ˵
+	uword_t StackBase{};					//ջʼַÿִforallѭ嶼￪ʼ
+	bool bMemoryUsed{};						//Resetִ֮йָҪڴ
+#ifdef PL0_64BIT
+	static constexpr uword_t HeapSize = (uword_t)1 << 33;	//64GB
+#else
+	static constexpr uword_t HeapSize = (uword_t)1 << 28;	//1GB
+#endif
+	std::shared_ptr<CHeapAllocator> Heap;
+	std::shared_ptr<COutputBuffer> Output;	//print
+	std::shared_ptr<CInputReader> Input;	//readreadarray룬
+
+	//forallѭ
+	uint32_t NumThreads;
+	std::unique_ptr<CWorkStealingPool> ThreadPool;
+	std::vector<std::unique_ptr<Pl0VirtualMachine>> Workers;	//ÿ߳һʹջһΪԼջ
+	bool bIsWorker{};
+	std::string* CapturedOutput{};			//Ϊʱprint׷ӵڱforallѭ˳
+	//ÿεջϵݹִУݹǶ׵forallѭҪƲջ
+	static constexpr uint32_t MaxForallDepth = 256;
+	uint32_t ForallDepth{};
 
-	std::mt19937 mt{ std::random_device{}() };
+	//ִforallѭĹջΪ[stackBase, stackLimit)
+	Pl0VirtualMachine(Pl0VirtualMachine& parent, uword_t stackBase, uword_t stackLimit);
+	//ڵǰջΪforallѭ彨ջִ֡һεغָмĴεʹɣseedindexȷ
+	void RunForallBody(uint32_t entry, uword_t staticLink, word_t index, uint64_t seed);
 
-	void Push(int32_t value);
-	int32_t Pop();
+	CRandom Random;
+	bool bHasSeed{};
+	uint64_t Seed{};
+	std::string SnapshotFile;				//snapshotдļΪʱsnapshotʲôҲ
+	std::unique_ptr<CProfiler> Profiler;	//Ϊʱܷ
+
+	//ʧʱ¼󣬷false
+	bool FailToLoad(ERunStatus status, const std::string& message);
+	//ִָʱ׳쳣RunProtected
+	[[noreturn]] void Fail(ERunStatus status, const std::string& message);
+	//ڴǰļʧʱmessage֮ϵַΪһ鱾عַ
+	[[noreturn]] void FailMemoryAccess(ERunStatus status, const char* message, uword_t address);
+	//ִfunctionеʱջ¼StatusErrorMessageУʱfalse
+	bool RunProtected(const std::function<void()>& function);
+	//ִָֱHLTָʱtruebLimitedΪtrueʱִbudgetָʱfalse֮Դһָ
+	//bProfiledΪtrueʱÿָúͷ֪ͨProfiler
+	template <bool bLimited, bool bProfiled>
+	bool Execute(uint64_t budget);
+
+	void Push(word_t value);
+	word_t Pop();
 	//ȡñĵַ
-	uint32_t GetVariableAddress(int16_t levelDiff, uint32_t offset);
+	uword_t GetVariableAddress(int16_t levelDiff, uword_t offset);
+	//ȡջ֡еSLڸ͵ĵַʱ
+	uword_t GetStaticLink(uword_t basePointer);
+	//ָָĵַڴʱ
+	void CheckAddress(uword_t address);
+	//һ׵ַӸõַʼlengthԪضջУָԪصָ
+	word_t* PopArray(uword_t length);
+	//Ϊ0ʱ
+	void CheckDivisor(word_t divisor);
+	//ȡʱ
+	void CheckReadStatus(EReadStatus status);
 
 	void ExecINT(const Instruction& instruction);
 	void ExecLIT(const Instruction& instruction);
@@ -38,9 +151,84 @@ private:
 	void ExecRAN(const Instruction& instruction);
 	void ExecSTR_v2(const Instruction& instruction);
 	void ExecPOP(const Instruction& instruction);
+	void ExecCAL_v2(const Instruction& instruction);
+	void ExecLDG(const Instruction& instruction);
+	void ExecSTO_v2(const Instruction& instruction);
+	void ExecFOR(const Instruction& instruction);
+	void ExecJTB(const Instruction& instruction);
+	void ExecVEC(const Instruction& instruction);
+	void ExecFAL(const Instruction& instruction);
+	void ExecNEW(const Instruction& instruction);
+	void ExecFRE(const Instruction& instruction);
+	void ExecRED(const Instruction& instruction);
+	void ExecRDA(const Instruction& instruction);
+	void ExecSNP(const Instruction& instruction);
 
 public:
-	Pl0VirtualMachine(const std::string& executableFile);
-	void Run();
+	static constexpr uword_t DefaultMaxStackSize = ((uword_t)1 << 30) / sizeof(word_t);		//1GB
+
+	//maxStackSizeΪջĵԪݶΣڴʱű
+	explicit Pl0VirtualMachine(uword_t maxStackSize = DefaultMaxStackSize);
+	~Pl0VirtualMachine();
+	Pl0VirtualMachine(const Pl0VirtualMachine&) = delete;
+	Pl0VirtualMachine& operator=(const Pl0VirtualMachine&) = delete;
+
+	//ļڴеĿִļõĳɶLoadʽʱؿָ룬errorMessageΪϢ
+	static std::shared_ptr<const SProgram> ReadProgram(const std::string& executableFile, std::string& errorMessage);
+	static std::shared_ptr<const SProgram> ReadProgram(const void* data, size_t size, std::string& errorMessage);
+	/*
+	ɱڴɵָкݶֱӵõ򣬲Ҫִļ
+	ַʽָִʱԽڴ桢ƻջĳΪʽ󣬷ؿָ룬errorMessageΪϢ
+	*/
+	static std::shared_ptr<const SProgram> CreateProgram(std::vector<Instruction> instructions, uword_t dataAddress, std::vector<word_t> data, std::string& errorMessage);
+
+	//ResetʧʱfalseGetStatus()GetErrorMessage()ԭ
+	bool Load(const std::string& executableFile);
+	bool Load(const void* data, size_t size);
+	bool Load(std::shared_ptr<const SProgram> program);
+	//صʱ״̬ջͶѣ·ݶΣڴforallѭ̶߳ʹ
+	void Reset();
+	//ִгֱFinished߳ǰдеٴRunֱӷͬĽ
+	ERunStatus Run();
+	/*
+	ִnumInstructionsָڴ֮ǰʱRunͬ򷵻Suspended֮ԼRunRunFor
+	forallѭһָеĵִꣻúִܶ߳
+	*/
+	ERunStatus RunFor(uint64_t numInstructions);
+	ERunStatus GetStatus() const;
+	const std::string& GetErrorMessage() const;
+
+	//ִforallѭ߳ĬΪӲ߳һִforallѭʱ̣֮߳ٸı
+	void SetNumThreads(uint32_t numThreads);
+	//ӣͬӵõͬĽResetҲ¿ʼĬÿResetʹ
+	void SetSeed(uint64_t seed);
+	//printĬΪ׼
+	void SetOutput(std::shared_ptr<COutputBuffer> output);
+	//readreadarray룬ĬΪ׼
+	void SetInput(std::shared_ptr<CInputReader> input);
+	//ѵͳϢ
+	void PrintHeapStats(std::ostream& out);
+
+	/*
+	գջ[0, StackPointer)õĲ֡Ĵѷ״̬λúѾ
+	ֻReadySuspendedʱ棨RunForغִsnapshotʱдʧʱfalse״̬
+	*/
+	bool SaveSnapshot(const std::string& snapshotFile, std::string& errorMessage);
+	/*
+	صʱ״̬֮RunӱʱһָѾ뱣ʱĳ򣬲ջСͬ
+	еڴдʱƵķʽӳ䣬Ҫȡļ˺ܿ죻ʹЩڴڼļܱ޸
+	ʧʱfalse״̬ΪSnapshotErrorResetִ֮
+	*/
+	bool RestoreSnapshot(const std::string& snapshotFile);
+	//snapshotдĿļ
+	void SetSnapshotFile(const std::string& snapshotFile);
+
+	/*
+	ѾĳܷͳÿӳÿԴִеָʱ䣬ResetRestoreSnapshotʱգLoadһٷ
+	symbolsΪɵķűΪʱӳֻԵַʾڼforallѭִУÿεѭһε
+	*/
+	void EnableProfiling(std::shared_ptr<const SSymbolTable> symbols = nullptr);
+	//ûнܷʱΪ
+	const CProfiler* GetProfiler() const;
 };
 
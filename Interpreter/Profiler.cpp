@@ -0,0 +1,347 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+#include "Instruction.h"
+
+CProfiler::CProfiler(size_t numInstructions, std::shared_ptr<const SSymbolTable> symbols)
+	: InstructionCounts(numInstructions), SourceLines(1), LineOfAddress(numInstructions)
+{
+	//űеָĩβHLT
+	if (symbols && symbols->NumInstructions + 1 == numInstructions) Symbols = std::move(symbols);
+
+	//ͬһеָܲѭǰָԴļкţϲ
+	if (Symbols) {
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> lineIndices;
+		const std::vector<SSymbolLine>& lines = Symbols->Lines;
+		for (size_t i{}; i < lines.size(); i++) {
+			auto [it, inserted] = lineIndices.insert({ { lines[i].File,lines[i].Line },(uint32_t)SourceLines.size() });
+			if (inserted) SourceLines.push_back(it->first);
+			size_t end = i + 1 < lines.size() ? lines[i + 1].Address : Symbols->NumInstructions;
+			for (size_t address = lines[i].Address; address < end; address++) {
+				LineOfAddress[address] = it->second;
+			}
+		}
+	}
+	LineTimes.resize(SourceLines.size());
+	Reset();
+}
+
+void CProfiler::Reset()
+{
+	std::fill(InstructionCounts.begin(), InstructionCounts.end(), 0);
+	std::fill(LineTimes.begin(), LineTimes.end(), CClock::duration{});
+	Nodes.clear();
+	Nodes.push_back({ 0,0 });
+	Nodes[0].Calls = 1;
+	CurrentNode = 0;
+	PauseTime = CClock::now();
+	Frames.assign(1, { 0,PauseTime });
+	CurrentLine = 0;
+	LineStart = PauseTime;
+}
+
+bool CProfiler::HasSymbols() const
+{
+	return Symbols != nullptr;
+}
+
+void CProfiler::SwitchLine(uint32_t line)
+{
+	CClock::time_point now = CClock::now();
+	LineTimes[CurrentLine] += now - LineStart;
+	LineStart = now;
+	CurrentLine = line;
+}
+
+void CProfiler::OnCall(uint32_t address)
+{
+	uint32_t child{};
+	for (uint32_t node : Nodes[CurrentNode].Children) {
+		if (Nodes[node].Procedure == address) {
+			child = node;
+			break;
+		}
+	}
+	if (child == 0) {
+		child = Nodes.size();
+		Nodes.push_back({ address,CurrentNode });
+		Nodes[CurrentNode].Children.push_back(child);
+	}
+	Nodes[child].Calls++;
+	Frames.push_back({ child,CClock::now() });
+	CurrentNode = child;
+}
+
+void CProfiler::OnReturn()
+{
+	//򷵻غֻʣHLTӿջָʱ֪֮ǰĵãķҲ
+	if (Frames.size() <= 1) return;
+	Nodes[Frames.back().Node].Time += CClock::now() - Frames.back().Start;
+	Frames.pop_back();
+	CurrentNode = Frames.back().Node;
+}
+
+void CProfiler::Resume()
+{
+	//ֹͣڼʱ䲻ִеĵú͵ǰ
+	CClock::duration paused = CClock::now() - PauseTime;
+	for (auto& frame : Frames) {
+		frame.Start += paused;
+	}
+	LineStart += paused;
+}
+
+void CProfiler::Pause()
+{
+	PauseTime = CClock::now();
+	LineTimes[CurrentLine] += PauseTime - LineStart;
+	LineStart = PauseTime;
+}
+
+std::string CProfiler::GetProcedureName(uint32_t address) const
+{
+	if (Symbols) {
+		auto it = std::lower_bound(Symbols->Procedures.begin(), Symbols->Procedures.end(), address,
+			[](const SSymbolProcedure& procedure, uint32_t address) { return procedure.Address < address; });
+		if (it != Symbols->Procedures.end() && it->Address == address) return it->Name;
+	}
+	return address == 0 ? "main" : "procedure@" + std::to_string(address);
+}
+
+std::string CProfiler::GetLineName(uint32_t line) const
+{
+	if (line == 0) return "(no line)";
+	auto [file, lineNumber] = SourceLines[line];
+	const std::string& fileName = Symbols->Files[file];
+	return (fileName.empty() ? "line " : fileName + ":") + std::to_string(lineNumber);
+}
+
+std::vector<CProfiler::CClock::duration> CProfiler::GetNodeTimes() const
+{
+	std::vector<CClock::duration> times(Nodes.size());
+	for (size_t i{}; i < Nodes.size(); i++) {
+		times[i] = Nodes[i].Time;
+	}
+	for (auto& frame : Frames) {
+		times[frame.Node] += PauseTime - frame.Start;
+	}
+	return times;
+}
+
+template<typename FEnter, typename FLeave>
+void CProfiler::VisitNodes(FEnter enter, FLeave leave) const
+{
+	//ݹʱҲܳʹõݹ
+	std::vector<std::pair<uint32_t, size_t>> stack{ { 0,0 } };	//ڵ㣬һҪʵӽڵ㣩
+	enter(0);
+	while (!stack.empty()) {
+		auto& [node, next] = stack.back();
+		if (next < Nodes[node].Children.size()) {
+			uint32_t child = Nodes[node].Children[next++];
+			enter(child);
+			stack.push_back({ child,0 });
+		}
+		else {
+			leave(node);
+			stack.pop_back();
+		}
+	}
+}
+
+void CProfiler::PrintReport(std::ostream& out) const
+{
+	using CMilliseconds = std::chrono::duration<double, std::milli>;
+
+	//ÿڵʱ䣬Լڵָ
+	std::vector<CClock::duration> times = GetNodeTimes();
+	std::vector<CClock::duration> selfTimes = times;
+	std::vector<uint64_t> totalInstructions(Nodes.size());
+	for (size_t i = Nodes.size(); i-- > 0;) {
+		totalInstructions[i] += Nodes[i].Instructions;
+		if (i == 0) break;
+		selfTimes[Nodes[i].Parent] -= times[i];
+		totalInstructions[Nodes[i].Parent] += totalInstructions[i];
+	}
+	double totalMilliseconds = CMilliseconds(times[0]).count();
+	uint64_t numInstructions = totalInstructions[0];
+
+	//ӳܣݹʱڵʱָֻһ
+	struct SProcedureStats
+	{
+		uint32_t Address;
+		uint64_t Calls{};
+		uint64_t SelfInstructions{};
+		uint64_t TotalInstructions{};
+		CClock::duration SelfTime{};
+		CClock::duration TotalTime{};
+	};
+	std::map<uint32_t, SProcedureStats> procedures;
+	std::unordered_map<uint32_t, uint32_t> activeCalls;		//ӳڵǰϳֵĴ
+	VisitNodes([&](uint32_t node) {
+		uint32_t address = Nodes[node].Procedure;
+		SProcedureStats& stats = procedures.insert({ address,{ address } }).first->second;
+		stats.Calls += Nodes[node].Calls;
+		stats.SelfInstructions += Nodes[node].Instructions;
+		stats.SelfTime += selfTimes[node];
+		if (activeCalls[address]++ == 0) {
+			stats.TotalInstructions += totalInstructions[node];
+			stats.TotalTime += times[node];
+		}
+		}, [&](uint32_t node) { activeCalls[Nodes[node].Procedure]--; });
+	std::vector<SProcedureStats> sortedProcedures;
+	for (auto& [address, stats] : procedures) {
+		sortedProcedures.push_back(stats);
+	}
+	std::stable_sort(sortedProcedures.begin(), sortedProcedures.end(),
+		[](const SProcedureStats& a, const SProcedureStats& b) { return a.SelfTime > b.SelfTime; });
+
+	auto percent = [](double part, double total) { return total > 0 ? part / total * 100 : 0.0; };
+	out << "========= Profile =========" << std::endl;
+	out << std::fixed << std::setprecision(3);
+	out << "instructions: " << numInstructions << ", time: " << totalMilliseconds << " ms" << std::endl << std::endl;
+	out << std::setw(12) << "self ms" << std::setw(8) << "self %" << std::setw(12) << "total ms" << std::setw(8) << "total %"
+		<< std::setw(12) << "calls" << std::setw(16) << "self instr" << std::setw(16) << "total instr" << "  procedure" << std::endl;
+	for (auto& stats : sortedProcedures) {
+		double selfMilliseconds = CMilliseconds(stats.SelfTime).count();
+		double totalProcedureMilliseconds = CMilliseconds(stats.TotalTime).count();
+		out << std::setprecision(3) << std::setw(12) << selfMilliseconds
+			<< std::setprecision(1) << std::setw(8) << percent(selfMilliseconds, totalMilliseconds)
+			<< std::setprecision(3) << std::setw(12) << totalProcedureMilliseconds
+			<< std::setprecision(1) << std::setw(8) << percent(totalProcedureMilliseconds, totalMilliseconds)
+			<< std::setw(12) << stats.Calls << std::setw(16) << stats.SelfInstructions << std::setw(16) << stats.TotalInstructions
+			<< "  " << GetProcedureName(stats.Address) << std::endl;
+	}
+
+	if (!Symbols) {
+		out << std::endl << "No symbol table, compile with --symbols to see procedure names and source lines." << std::endl;
+		out << std::defaultfloat;
+		return;
+	}
+
+	//л
+	std::vector<uint64_t> lineInstructions(SourceLines.size());
+	for (size_t address{}; address < InstructionCounts.size(); address++) {
+		lineInstructions[LineOfAddress[address]] += InstructionCounts[address];
+	}
+	std::vector<uint32_t> lines;
+	for (uint32_t line{}; line < SourceLines.size(); line++) {
+		if (lineInstructions[line] > 0) lines.push_back(line);
+	}
+	std::stable_sort(lines.begin(), lines.end(), [&](uint32_t a, uint32_t b) { return LineTimes[a] > LineTimes[b]; });
+
+	out << std::endl;
+	out << std::setw(12) << "time ms" << std::setw(8) << "time %" << std::setw(16) << "instructions" << std::setw(8) << "instr %" << "  line" << std::endl;
+	for (uint32_t line : lines) {
+		double milliseconds = CMilliseconds(LineTimes[line]).count();
+		out << std::setprecision(3) << std::setw(12) << milliseconds
+			<< std::setprecision(1) << std::setw(8) << percent(milliseconds, totalMilliseconds)
+			<< std::setw(16) << lineInstructions[line] << std::setw(8) << percent((double)lineInstructions[line], (double)numInstructions)
+			<< "  " << GetLineName(line) << std::endl;
+	}
+	out << std::defaultfloat;
+}
+
+void CProfiler::WriteFoldedStacks(std::ostream& out) const
+{
+	std::vector<CClock::duration> selfTimes = GetNodeTimes();
+	for (size_t i = Nodes.size(); i-- > 1;) {
+		selfTimes[Nodes[i].Parent] -= Nodes[i].Time;
+	}
+	for (auto& frame : Frames) {
+		if (frame.Node != 0) selfTimes[Nodes[frame.Node].Parent] -= PauseTime - frame.Start;
+	}
+
+	//ϸӳԷֺӣ뿪ڵʱȥ
+	std::string stack;
+	std::vector<size_t> stackLengths;
+	VisitNodes([&](uint32_t node) {
+		stackLengths.push_back(stack.size());
+		if (node != 0) stack += ';';
+		stack += GetProcedureName(Nodes[node].Procedure);
+		int64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(selfTimes[node]).count();
+		if (microseconds > 0) out << stack << ' ' << microseconds << '\n';
+		}, [&](uint32_t node) {
+			stack.resize(stackLengths.back());
+			stackLengths.pop_back();
+		});
+}
+
+bool CProfiler::WriteFiles(const std::string& reportFile, const std::string& foldedFile, std::string& errorMessage) const
+{
+	if (!reportFile.empty()) {
+		std::ofstream file(reportFile);
+		PrintReport(file);
+		if (!file) {
+			errorMessage = "Cannot write profile: " + reportFile;
+			return false;
+		}
+	}
+	if (!foldedFile.empty()) {
+		std::ofstream file(foldedFile);
+		WriteFoldedStacks(file);
+		if (!file) {
+			errorMessage = "Cannot write profile: " + foldedFile;
+			return false;
+		}
+	}
+	return true;
+}
+
+std::shared_ptr<const SSymbolTable> CProfiler::ReadSymbols(const std::string& symbolFile, std::string& errorMessage)
+{
+	std::ifstream file(symbolFile);
+	if (!file.is_open()) {
+		errorMessage = "Cannot open symbol file: " + symbolFile;
+		return nullptr;
+	}
+
+	auto symbols = std::make_shared<SSymbolTable>();
+	std::string line, kind;
+	int wordBits{};
+	std::getline(file, line);
+	std::istringstream header(line);
+	if (!(header >> kind >> wordBits >> symbols->NumInstructions) || kind != "pl0-symbols") {
+		errorMessage = "Symbol file format error: " + symbolFile;
+		return nullptr;
+	}
+	if (wordBits != WordBits) {
+		errorMessage = "The symbol file " + symbolFile + " is for " + std::to_string(wordBits) + "-bit words, but this interpreter uses " + std::to_string(WordBits) + "-bit words";
+		return nullptr;
+	}
+
+	//ַ밴С˳Ҷָ֮
+	bool valid = true;
+	while (valid && std::getline(file, line)) {
+		std::istringstream fields(line);
+		fields >> kind;
+		if (kind == "file") {
+			std::string path;
+			std::getline(fields >> std::ws, path);
+			symbols->Files.push_back(path);
+		}
+		else if (kind == "procedure") {
+			SSymbolProcedure procedure;
+			valid = fields >> procedure.Address >> procedure.Name && procedure.Address < symbols->NumInstructions
+				&& (symbols->Procedures.empty() || symbols->Procedures.back().Address < procedure.Address);
+			symbols->Procedures.push_back(procedure);
+		}
+		else if (kind == "line") {
+			SSymbolLine sourceLine;
+			valid = fields >> sourceLine.Address >> sourceLine.File >> sourceLine.Line && sourceLine.Address < symbols->NumInstructions
+				&& sourceLine.File < symbols->Files.size() && (symbols->Lines.empty() || symbols->Lines.back().Address < sourceLine.Address);
+			symbols->Lines.push_back(sourceLine);
+		}
+		else {
+			valid = false;
+		}
+	}
+	if (!valid) {
+		errorMessage = "Symbol file format error: " + symbolFile;
+		return nullptr;
+	}
+	return symbols;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SymbolTable.h"
+
+/*
+ִܷÿָúͷʱ֪ͨͳÿӳÿԴִеָõʱ
+ӳCALָĿַֺ֣кԱɵķűûзűʱӳԵַʾҲܰͳ
+ùϵ¼ڵУÿڵǴʼһɴ˵õڵʱ۵ĵջ
+ֻڵáغִеָʱȡʱӣִͬһеָʱֻ
+*/
+class CProfiler
+{
+private:
+	using CClock = std::chrono::steady_clock;
+
+	//Ľڵ㣬ӽڵ±Ǵڸڵ
+	struct SNode
+	{
+		uint32_t Procedure;						//ӳڵַ
+		uint32_t Parent;
+		std::vector<uint32_t> Children;
+		uint64_t Calls{};
+		uint64_t Instructions{};				//ĩ˵ӳִеָ
+		CClock::duration Time{};				//Ѿصĸεõʱ֮ͣ
+	};
+	//ִеһε
+	struct SFrame
+	{
+		uint32_t Node;
+		CClock::time_point Start;
+	};
+
+	std::shared_ptr<const SSymbolTable> Symbols;
+	std::vector<uint64_t> InstructionCounts;	//ÿִָд
+	std::vector<std::pair<uint32_t, uint32_t>> SourceLines;	//Դļкţ±0κһ
+	std::vector<uint32_t> LineOfAddress;		//ÿָڵSourceLinesе±
+	std::vector<CClock::duration> LineTimes;	//±SourceLinesͬ
+	uint32_t CurrentLine{};
+	CClock::time_point LineStart;
+	std::vector<SNode> Nodes;					//Nodes[0]
+	std::vector<SFrame> Frames;					//Frames[0]һֱᵯ
+	uint32_t CurrentNode{};
+	CClock::time_point PauseTime;				//һPauseʱ
+
+	void SwitchLine(uint32_t line);
+	std::string GetProcedureName(uint32_t address) const;
+	std::string GetLineName(uint32_t line) const;
+	//ڵڵʱ䣬ִеĵü㵽һPauseΪֹ
+	std::vector<CClock::duration> GetNodeTimes() const;
+	//ȱ롢뿪ÿڵʱֱenterleave
+	template<typename FEnter, typename FLeave>
+	void VisitNodes(FEnter enter, FLeave leave) const;
+
+public:
+	//numInstructionsΪָĩβHLTsymbolsΪջ߲ʱʹ
+	CProfiler(size_t numInstructions, std::shared_ptr<const SSymbolTable> symbols);
+	//ͳƽصʼִ֮ǰ
+	void Reset();
+	bool HasSymbols() const;
+
+	//ִaddressָ֮ǰ
+	void OnInstruction(uint32_t address)
+	{
+		InstructionCounts[address]++;
+		Nodes[CurrentNode].Instructions++;
+		if (LineOfAddress[address] != CurrentLine) SwitchLine(LineOfAddress[address]);
+	}
+	//CALCAL_v2˵ַΪaddressӳ򣬻߿ʼִеַΪaddressforallѭ
+	void OnCall(uint32_t address);
+	void OnReturn();
+	//ʼִָֹͣʱã֮ʱżӳ
+	void Resume();
+	void Pause();
+
+	//ʱӳԼʱ
+	void PrintReport(std::ostream& out) const;
+	//۵ĵջÿΪ"main;p;q ΢"ʱΪĩ˵ӳʱ䣬ֱӽflamegraph.plɻͼ
+	void WriteFoldedStacks(std::ostream& out) const;
+	//ѱдreportFile۵ĵջдfoldedFileļΪʱддʱfalseerrorMessageΪϢ
+	bool WriteFiles(const std::string& reportFile, const std::string& foldedFile, std::string& errorMessage) const;
+
+	//ȡɵķűļʽʱnullptrerrorMessageΪϢ
+	static std::shared_ptr<const SSymbolTable> ReadSymbols(const std::string& symbolFile, std::string& errorMessage);
+};
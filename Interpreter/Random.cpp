@@ -0,0 +1,38 @@
+#include "Random.h"
+#include <algorithm>
+#include <random>
+
+static uint64_t SplitMix64(uint64_t& x)
+{
+	uint64_t z = (x += 0x9E3779B97F4A7C15);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+CRandom::CRandom(uint64_t seed)
+{
+	for (auto& word : State) {
+		word = SplitMix64(seed);
+	}
+}
+
+CRandom::CRandom() : CRandom(((uint64_t)std::random_device{}() << 32) ^ std::random_device{}())
+{
+}
+
+CRandom CRandom::ForStream(uint64_t seed, uint64_t stream)
+{
+	//Ȱstreamɢʹڵstreamõܴ
+	return CRandom(seed ^ SplitMix64(stream));
+}
+
+std::array<uint64_t, 4> CRandom::GetState() const
+{
+	return { State[0],State[1],State[2],State[3] };
+}
+
+void CRandom::SetState(const std::array<uint64_t, 4>& state)
+{
+	std::copy(state.begin(), state.end(), State);
+}
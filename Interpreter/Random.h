@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <bit>
+
+/*
+xoshiro256**״ֻ̬32ֽڣÿֻ輸λͳ˷
+ͬӵõͬУforallѭÿεʹɣѭӣѭȷĶУ߳͵޹
+*/
+class CRandom
+{
+private:
+	uint64_t State[4];
+
+public:
+	//ͨsplitmix64չΪ״̬Ҳõص
+	explicit CRandom(uint64_t seed);
+	//std::random_device
+	CRandom();
+	//streamͬstreamõص
+	static CRandom ForStream(uint64_t seed, uint64_t stream);
+
+	//ȫ״̬Ŀ
+	std::array<uint64_t, 4> GetState() const;
+	void SetState(const std::array<uint64_t, 4>& state);
+
+	uint64_t Next();
+	//[0, bound)оȷֲûȡģɵƫboundΪ0
+	uint64_t Bounded(uint64_t bound);
+};
+
+//ĺÿrandomָеãͷļԱ
+inline uint64_t CRandom::Next()
+{
+	uint64_t result = std::rotl(State[1] * 5, 7) * 9;
+	uint64_t t = State[1] << 17;
+	State[2] ^= State[0];
+	State[3] ^= State[1];
+	State[1] ^= State[2];
+	State[0] ^= State[3];
+	State[2] ^= t;
+	State[3] = std::rotl(State[3], 45);
+	return result;
+}
+
+inline uint64_t CRandom::Bounded(uint64_t bound)
+{
+	if (bound <= UINT32_MAX) {
+		//Lemireķ32λbound32λΪֻе32λںСһʱҪ
+		uint64_t product = (Next() >> 32) * bound;
+		uint32_t low = (uint32_t)product;
+		if (low < bound) {
+			uint32_t threshold = (uint32_t)(-(uint32_t)bound) % (uint32_t)bound;
+			while (low < threshold) {
+				product = (Next() >> 32) * bound;
+				low = (uint32_t)product;
+			}
+		}
+		return product >> 32;
+	}
+
+	//boundȡСbound2Ϊ룬boundʱɣƽ
+	uint64_t mask = bound - 1;
+	mask |= mask >> 1;
+	mask |= mask >> 2;
+	mask |= mask >> 4;
+	mask |= mask >> 8;
+	mask |= mask >> 16;
+	mask |= mask >> 32;
+	uint64_t value;
+	do {
+		value = Next() & mask;
+	} while (value >= bound);
+	return value;
+}
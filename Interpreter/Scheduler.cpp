@@ -0,0 +1,88 @@
+#include "Scheduler.h"
+#include <algorithm>
+
+bool CScheduler::RunsLater(const SJob& a, const SJob& b)
+{
+	if (a.Priority != b.Priority) return a.Priority < b.Priority;
+	return a.Sequence > b.Sequence;
+}
+
+CScheduler::CScheduler(uint32_t numThreads, uint64_t timeSlice) : TimeSlice(std::max<uint64_t>(timeSlice, 1))
+{
+	numThreads = std::max<uint32_t>(numThreads, 1);
+	for (uint32_t i{}; i < numThreads; i++) {
+		Threads.emplace_back(&CScheduler::WorkerLoop, this);
+	}
+}
+
+CScheduler::~CScheduler()
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		bStopping = true;
+	}
+	JobReady.notify_all();
+	for (auto& thread : Threads) {
+		thread.join();
+	}
+}
+
+void CScheduler::Submit(Pl0VirtualMachine& machine, int priority, std::function<void(ERunStatus)> onFinished)
+{
+	//߳Ѿռкˣforallѭٴֻ߳ụ
+	machine.SetNumThreads(1);
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		NumUnfinished++;
+		ReadyJobs.push_back({ &machine,priority,NextSequence++,std::move(onFinished) });
+		std::push_heap(ReadyJobs.begin(), ReadyJobs.end(), RunsLater);
+	}
+	JobReady.notify_one();
+}
+
+void CScheduler::Wait()
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	AllFinished.wait(lock, [&] { return NumUnfinished == 0; });
+}
+
+uint64_t CScheduler::GetNumSlices()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return NumSlices;
+}
+
+void CScheduler::WorkerLoop()
+{
+	while (true) {
+		SJob job;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			JobReady.wait(lock, [&] { return bStopping || !ReadyJobs.empty(); });
+			if (ReadyJobs.empty()) return;
+			std::pop_heap(ReadyJobs.begin(), ReadyJobs.end(), RunsLater);
+			job = std::move(ReadyJobs.back());
+			ReadyJobs.pop_back();
+			NumSlices++;
+		}
+
+		ERunStatus status = job.Machine->RunFor(TimeSlice);
+		if (status == ERunStatus::Suspended) {
+			//ŻͬһȼĶβ
+			{
+				std::lock_guard<std::mutex> lock(Mutex);
+				job.Sequence = NextSequence++;
+				ReadyJobs.push_back(std::move(job));
+				std::push_heap(ReadyJobs.begin(), ReadyJobs.end(), RunsLater);
+			}
+			JobReady.notify_one();
+			continue;
+		}
+
+		//صύNumUnfinished֮ǰѾ룬Waitǰ
+		job.OnFinished(status);
+		std::lock_guard<std::mutex> lock(Mutex);
+		if (--NumUnfinished == 0) AllFinished.notify_all();
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Pl0VirtualMachine.h"
+
+/*
+ôִ߳УÿȡȼߵľRunForһʱƬ󣬳ûнͷŻضβ
+ͬһȼڰȷתʱܳĳ򲻻һֱռ̵̣߳ĳڼʱƬ
+ȼߵȼ͵ִ
+*/
+class CScheduler
+{
+private:
+	struct SJob {
+		Pl0VirtualMachine* Machine;
+		int Priority;
+		uint64_t Sequence;					//е˳ͬһȼСִ
+		std::function<void(ERunStatus)> OnFinished;
+	};
+	//ڶѵıȽϣabִ
+	static bool RunsLater(const SJob& a, const SJob& b);
+
+	uint64_t TimeSlice;
+	std::vector<SJob> ReadyJobs;			//RunsLater֯Ķ
+	uint64_t NextSequence{};
+	size_t NumUnfinished{};					//Ѿύûнִе
+	uint64_t NumSlices{};
+	bool bStopping{};
+	std::mutex Mutex;
+	std::condition_variable JobReady;
+	std::condition_variable AllFinished;
+	std::vector<std::thread> Threads;
+
+	void WorkerLoop();
+
+public:
+	//numThreadṣ߳ÿʱƬִtimeSliceָ
+	CScheduler(uint32_t numThreads, uint64_t timeSlice);
+	//ȴٷ
+	~CScheduler();
+	CScheduler(const CScheduler&) = delete;
+	CScheduler& operator=(const CScheduler&) = delete;
+
+	/*
+	ύһѾpriorityԽԽִУеforallѭΪִ
+	ִ߳еonFinished(״̬)пύͬһڴ֮ǰ߲ʹ
+	*/
+	void Submit(Pl0VirtualMachine& machine, int priority, std::function<void(ERunStatus)> onFinished);
+	//ȴѾύ
+	void Wait();
+	//ѾִеʱƬ
+	uint64_t GetNumSlices();
+};
@@ -0,0 +1,309 @@
+#include "Server.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+//ȡsizeֽڣӹرջʱfalse
+static bool ReadAll(int socket, void* data, size_t size)
+{
+	char* p = (char*)data;
+	while (size > 0) {
+		ssize_t count = read(socket, p, size);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+		p += count;
+		size -= count;
+	}
+	return true;
+}
+
+//һ֡֡ͷ֮ݣϲΪһϵͳ
+static bool SendFrame(int socket, const SResponseHeader& header, const char* data, size_t size)
+{
+	iovec parts[2] = { { (void*)&header,sizeof(header) },{ (void*)data,size } };
+	iovec* part = parts;
+	int numParts = size ? 2 : 1;
+	while (numParts > 0) {
+		ssize_t count = writev(socket, part, numParts);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+		while (numParts > 0 && (size_t)count >= part->iov_len) {
+			count -= part->iov_len;
+			part++;
+			numParts--;
+		}
+		if (numParts > 0) {
+			part->iov_base = (char*)part->iov_base + count;
+			part->iov_len -= count;
+		}
+	}
+	return true;
+}
+
+static bool SendAll(int socket, const char* data, size_t size)
+{
+	while (size > 0) {
+		ssize_t count = write(socket, data, size);
+		if (count < 0 && errno == EINTR) continue;
+		if (count <= 0) return false;
+		data += count;
+		size -= count;
+	}
+	return true;
+}
+
+static bool MakeAddress(const std::string& socketPath, sockaddr_un& address, std::string& errorMessage)
+{
+	address = {};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path)) {
+		errorMessage = "Socket path too long: " + socketPath;
+		return false;
+	}
+	std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+	return true;
+}
+#endif
+
+CServer::CServer(const std::string& socketPath, uint32_t numThreads, uword_t maxStackSize)
+	: SocketPath(socketPath), NumThreads(std::max<uint32_t>(numThreads, 1)), MaxStackSize(maxStackSize)
+{
+}
+
+CServer::~CServer()
+{
+#ifndef _WIN32
+	if (ListenSocket >= 0) {
+		close(ListenSocket);
+		unlink(SocketPath.c_str());
+	}
+#endif
+}
+
+std::shared_ptr<const SProgram> CServer::GetProgram(const std::string& executable, std::string& errorMessage)
+{
+	size_t hash = std::hash<std::string>{}(executable);
+	{
+		std::lock_guard<std::mutex> lock(CacheMutex);
+		auto it = CacheIndex.find(hash);
+		//ϣͬʱҪȽݣֻͬɹϣͬ
+		if (it != CacheIndex.end() && it->second->Executable == executable) {
+			Cache.splice(Cache.begin(), Cache, it->second);
+			return it->second->Program;
+		}
+	}
+
+	//Ҫ߳ͬʱͬһʱ滻ȷ
+	std::shared_ptr<const SProgram> program = Pl0VirtualMachine::ReadProgram(executable.data(), executable.size(), errorMessage);
+	if (!program) return nullptr;
+
+	std::lock_guard<std::mutex> lock(CacheMutex);
+	auto it = CacheIndex.find(hash);
+	if (it != CacheIndex.end()) {
+		Cache.erase(it->second);
+		CacheIndex.erase(it);
+	}
+	Cache.push_front({ hash,executable,program });
+	CacheIndex[hash] = Cache.begin();
+	if (Cache.size() > CacheCapacity) {
+		CacheIndex.erase(Cache.back().Hash);
+		Cache.pop_back();
+	}
+	return program;
+}
+
+#ifdef _WIN32
+
+bool CServer::Listen(std::string& errorMessage)
+{
+	errorMessage = "--serve is not supported on this platform";
+	return false;
+}
+
+void CServer::Run()
+{
+}
+
+void CServer::ServeConnection(SSlot& slot)
+{
+}
+
+void CServer::WorkerLoop()
+{
+}
+
+CServerClient::~CServerClient()
+{
+}
+
+bool CServerClient::Connect(const std::string& socketPath, std::string& errorMessage)
+{
+	errorMessage = "--connect is not supported on this platform";
+	return false;
+}
+
+bool CServerClient::Run(const std::string& executable, const std::string& input, uint32_t flags, uint64_t seed,
+	const std::function<void(const char*, size_t)>& onOutput, ERunStatus& status, std::string& errorMessage)
+{
+	return false;
+}
+
+#else
+
+bool CServer::Listen(std::string& errorMessage)
+{
+	sockaddr_un address;
+	if (!MakeAddress(SocketPath, address, errorMessage)) return false;
+
+	ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (ListenSocket < 0) {
+		errorMessage = std::string("Cannot create socket: ") + std::strerror(errno);
+		return false;
+	}
+	unlink(SocketPath.c_str());
+	if (bind(ListenSocket, (sockaddr*)&address, sizeof(address)) < 0 || listen(ListenSocket, 128) < 0) {
+		errorMessage = "Cannot listen on " + SocketPath + ": " + std::strerror(errno);
+		close(ListenSocket);
+		ListenSocket = -1;
+		return false;
+	}
+	//ͻǰϿʱͲӦý
+	signal(SIGPIPE, SIG_IGN);
+	return true;
+}
+
+void CServer::Run()
+{
+	std::vector<std::thread> threads;
+	for (uint32_t i{}; i < NumThreads; i++) {
+		threads.emplace_back(&CServer::WorkerLoop, this);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void CServer::WorkerLoop()
+{
+	SSlot slot;
+	slot.Output = std::make_shared<COutputBuffer>([&slot](const char* data, size_t size) {
+		if (slot.bDisconnected) return;
+		SResponseHeader header{ EResponseType::Output,0,size };
+		if (!SendFrame(slot.Socket, header, data, size)) slot.bDisconnected = true;
+		});
+	//ÿ̴߳һӣforallѭڵǰִ߳
+	slot.Machine = std::make_unique<Pl0VirtualMachine>(MaxStackSize);
+	slot.Machine->SetOutput(slot.Output);
+	slot.Machine->SetNumThreads(1);
+
+	while (true) {
+		int client = accept(ListenSocket, nullptr, nullptr);
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+			return;
+		}
+		slot.Socket = client;
+		slot.bDisconnected = false;
+		ServeConnection(slot);
+		close(client);
+		slot.Socket = -1;
+	}
+}
+
+void CServer::ServeConnection(SSlot& slot)
+{
+	Pl0VirtualMachine& vm = *slot.Machine;
+	SRequestHeader request;
+	while (ReadAll(slot.Socket, &request, sizeof(request))) {
+		if (request.Magic != RequestMagic || request.ExecutableSize > MaxRequestSize || request.InputSize > MaxRequestSize) return;
+		std::string executable(request.ExecutableSize, '\0');
+		std::string input(request.InputSize, '\0');
+		if (!ReadAll(slot.Socket, executable.data(), executable.size()) || !ReadAll(slot.Socket, input.data(), input.size())) return;
+
+		ERunStatus status;
+		std::string errorMessage;
+		std::shared_ptr<const SProgram> program = GetProgram(executable, errorMessage);
+		if (!program) {
+			status = ERunStatus::InvalidExecutable;
+		}
+		else if (!vm.Load(program)) {
+			status = vm.GetStatus();
+			errorMessage = vm.GetErrorMessage();
+		}
+		else {
+			EInputFormat inputFormat = request.Flags & RequestBinaryInput ? EInputFormat::Binary : EInputFormat::Text;
+			vm.SetInput(std::make_shared<CInputReader>(input.data(), input.size(), inputFormat));
+			vm.SetSeed(request.Flags & RequestHasSeed ? request.Seed : slot.Random.Next());
+			slot.Output->SetFormat(request.Flags & RequestBinaryOutput ? EOutputFormat::Binary : EOutputFormat::Text);
+			//ִֶУÿ֮RunForأͻѾϿʱ
+			do {
+				status = vm.RunFor(SliceInstructions);
+			} while (status == ERunStatus::Suspended && !slot.bDisconnected);
+			errorMessage = vm.GetErrorMessage();
+		}
+		if (slot.bDisconnected) return;
+
+		SResponseHeader header{ EResponseType::Finished,(uint32_t)status,errorMessage.size() };
+		if (!SendFrame(slot.Socket, header, errorMessage.data(), errorMessage.size())) return;
+	}
+}
+
+CServerClient::~CServerClient()
+{
+	if (Socket >= 0) close(Socket);
+}
+
+bool CServerClient::Connect(const std::string& socketPath, std::string& errorMessage)
+{
+	sockaddr_un address;
+	if (!MakeAddress(socketPath, address, errorMessage)) return false;
+	Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (Socket < 0 || connect(Socket, (sockaddr*)&address, sizeof(address)) < 0) {
+		errorMessage = "Cannot connect to " + socketPath + ": " + std::strerror(errno);
+		return false;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	return true;
+}
+
+bool CServerClient::Run(const std::string& executable, const std::string& input, uint32_t flags, uint64_t seed,
+	const std::function<void(const char*, size_t)>& onOutput, ERunStatus& status, std::string& errorMessage)
+{
+	SRequestHeader request{ RequestMagic,flags,seed,executable.size(),input.size() };
+	if (!SendAll(Socket, (const char*)&request, sizeof(request)) || !SendAll(Socket, executable.data(), executable.size())
+		|| !SendAll(Socket, input.data(), input.size()))
+	{
+		errorMessage = "Connection to the server lost";
+		return false;
+	}
+
+	std::string data;
+	SResponseHeader header;
+	while (ReadAll(Socket, &header, sizeof(header))) {
+		data.resize(header.Size);
+		if (!ReadAll(Socket, data.data(), data.size())) break;
+		if (header.Type == EResponseType::Output) {
+			onOutput(data.data(), data.size());
+			continue;
+		}
+		status = (ERunStatus)header.Status;
+		errorMessage = data;
+		return true;
+	}
+	errorMessage = "Connection to the server lost";
+	return false;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Pl0VirtualMachine.h"
+#include "Random.h"
+
+/*
+פͻ֮Э飬ͨUnix׽ִ䣬ֻڱʹãֱʹñֽ
+һϿηͶÿΪSRequestHeaderִļ
+ÿĻظΪɸOutput֮֡ݣԼһFinished֮֡ǴϢ
+*/
+constexpr uint32_t RequestMagic = 0x52304C50;	//"PL0R"
+
+enum ERequestFlags : uint32_t
+{
+	RequestHasSeed = 1,
+	RequestBinaryOutput = 2,
+	RequestBinaryInput = 4
+};
+
+struct SRequestHeader
+{
+	uint32_t Magic;
+	uint32_t Flags;						//ERequestFlags
+	uint64_t Seed;
+	uint64_t ExecutableSize;
+	uint64_t InputSize;
+};
+
+enum class EResponseType : uint32_t
+{
+	Output,
+	Finished
+};
+
+struct SResponseHeader
+{
+	EResponseType Type;
+	uint32_t Status;					//Finished֡ΪERunStatus
+	uint64_t Size;						//֮ݵֽ
+};
+
+/*
+פĽUnix׽Ͻÿ߳һһֱδ߳̽ܵ
+ĳ򰴿ִļݵĹϣ棬ͬһٴʱֻҪResetִйз
+*/
+class CServer
+{
+private:
+	static constexpr size_t CacheCapacity = 256;				//ĳ
+	static constexpr uint64_t MaxRequestSize = (uint64_t)1 << 30;
+	static constexpr uint64_t SliceInstructions = 1 << 20;	//ÿִôָеأͻǷѾϿ
+
+	//ÿ̵߳д뵱ǰ
+	struct SSlot {
+		std::unique_ptr<Pl0VirtualMachine> Machine;
+		std::shared_ptr<COutputBuffer> Output;
+		int Socket{ -1 };
+		bool bDisconnected{};			//ʧܣͻѾϿ
+		CRandom Random;					//ûʱ
+	};
+	struct SCacheEntry {
+		size_t Hash;
+		std::string Executable;
+		std::shared_ptr<const SProgram> Program;
+	};
+
+	std::string SocketPath;
+	uint32_t NumThreads;
+	uword_t MaxStackSize;
+	int ListenSocket{ -1 };
+
+	std::mutex CacheMutex;
+	std::list<SCacheEntry> Cache;		//ʹõǰ
+	std::unordered_map<size_t, std::list<SCacheEntry>::iterator> CacheIndex;
+
+	//ȡÿִļӦĳ򣬻ûʱ뻺棻ʽʱؿָ
+	std::shared_ptr<const SProgram> GetProgram(const std::string& executable, std::string& errorMessage);
+	//δһϵֱͻ˹ر
+	void ServeConnection(SSlot& slot);
+	void WorkerLoop();
+
+public:
+	CServer(const std::string& socketPath, uint32_t numThreads, uword_t maxStackSize);
+	~CServer();
+	CServer(const CServer&) = delete;
+	CServer& operator=(const CServer&) = delete;
+
+	//׽ֲʼѾڵͬļᱻɾʧʱfalse
+	bool Listen(std::string& errorMessage);
+	//numThreads߳нܲӣ᷵
+	void Run();
+};
+
+//פĿͻˣһӿִж
+class CServerClient
+{
+private:
+	int Socket{ -1 };
+
+public:
+	CServerClient() = default;
+	~CServerClient();
+	CServerClient(const CServerClient&) = delete;
+	CServerClient& operator=(const CServerClient&) = delete;
+
+	bool Connect(const std::string& socketPath, std::string& errorMessage);
+	/*
+	ִпִļexecutableinputΪreadreadarrayȫ룻onOutput
+	ʱtruestatuserrorMessageΪ볣פӳʱfalse
+	*/
+	bool Run(const std::string& executable, const std::string& input, uint32_t flags, uint64_t seed,
+		const std::function<void(const char*, size_t)>& onOutput, ERunStatus& status, std::string& errorMessage);
+};
@@ -0,0 +1,198 @@
+#include "VectorKernels.h"
+
+#include <cstring>
+
+//VECTOR_WIDTHΪһĴеԪظ64λģʽ¼
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VECTOR_BYTES 32
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#define VECTOR_BYTES 16
+#else
+#define VECTOR_BYTES 0
+#endif
+#ifdef PL0_64BIT
+#define VECTOR_WIDTH (VECTOR_BYTES ? VECTOR_BYTES / 8 : 1)
+#else
+#define VECTOR_WIDTH (VECTOR_BYTES ? VECTOR_BYTES / 4 : 1)
+#endif
+
+
+/*
+ÿָͬһVectorΪһĴеVECTOR_WIDTHԪ
+δĶдLoadStoreԪ㣺AddLanesSubLanesMulLanesˮƽͣHorizontalSum
+*/
+#if defined(PL0_64BIT) && VECTOR_BYTES == 32
+using Vector = __m256i;
+static inline Vector Load(const word_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void Store(word_t* p, Vector v) { _mm256_storeu_si256((__m256i*)p, v); }
+static inline Vector Broadcast(word_t value) { return _mm256_set1_epi64x(value); }
+static inline Vector Zero() { return _mm256_setzero_si256(); }
+static inline Vector AddLanes(Vector a, Vector b) { return _mm256_add_epi64(a, b); }
+static inline Vector SubLanes(Vector a, Vector b) { return _mm256_sub_epi64(a, b); }
+//û64λĵλ˷a*bĵ64λ = aLow*bLow + ((aHigh*bLow + aLow*bHigh) << 32)
+static inline Vector MulLanes(Vector a, Vector b)
+{
+	__m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+	return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+}
+static inline word_t HorizontalSum(Vector v)
+{
+	__m128i sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+	return _mm_cvtsi128_si64(sum);
+}
+#elif defined(PL0_64BIT) && VECTOR_BYTES == 16
+using Vector = __m128i;
+static inline Vector Load(const word_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void Store(word_t* p, Vector v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline Vector Broadcast(word_t value) { return _mm_set1_epi64x(value); }
+static inline Vector Zero() { return _mm_setzero_si128(); }
+static inline Vector AddLanes(Vector a, Vector b) { return _mm_add_epi64(a, b); }
+static inline Vector SubLanes(Vector a, Vector b) { return _mm_sub_epi64(a, b); }
+static inline Vector MulLanes(Vector a, Vector b)
+{
+	__m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b), _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+	return _mm_add_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(cross, 32));
+}
+static inline word_t HorizontalSum(Vector v)
+{
+	return _mm_cvtsi128_si64(_mm_add_epi64(v, _mm_unpackhi_epi64(v, v)));
+}
+#elif VECTOR_BYTES == 32
+using Vector = __m256i;
+static inline Vector Load(const word_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void Store(word_t* p, Vector v) { _mm256_storeu_si256((__m256i*)p, v); }
+static inline Vector Broadcast(word_t value) { return _mm256_set1_epi32(value); }
+static inline Vector Zero() { return _mm256_setzero_si256(); }
+static inline Vector AddLanes(Vector a, Vector b) { return _mm256_add_epi32(a, b); }
+static inline Vector SubLanes(Vector a, Vector b) { return _mm256_sub_epi32(a, b); }
+static inline Vector MulLanes(Vector a, Vector b) { return _mm256_mullo_epi32(a, b); }
+static inline word_t HorizontalSum(Vector v)
+{
+	__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+#elif VECTOR_BYTES == 16
+using Vector = __m128i;
+static inline Vector Load(const word_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void Store(word_t* p, Vector v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline Vector Broadcast(word_t value) { return _mm_set1_epi32(value); }
+static inline Vector Zero() { return _mm_setzero_si128(); }
+static inline Vector AddLanes(Vector a, Vector b) { return _mm_add_epi32(a, b); }
+static inline Vector SubLanes(Vector a, Vector b) { return _mm_sub_epi32(a, b); }
+static inline Vector MulLanes(Vector a, Vector b)
+{
+#if defined(__SSE4_1__)
+	return _mm_mullo_epi32(a, b);
+#else
+	//SSE2û32λĵλ˷ֱżλλԪص64λ˻ȡ32λƴ
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+static inline word_t HorizontalSum(Vector v)
+{
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+#endif
+
+
+void VectorCopy(word_t* dst, const word_t* src, uword_t n)
+{
+	std::memmove(dst, src, (size_t)n * sizeof(word_t));
+}
+
+void VectorFill(word_t* dst, word_t value, uword_t n)
+{
+	uword_t i{};
+#if VECTOR_WIDTH > 1
+	Vector v = Broadcast(value);
+	for (; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH) {
+		Store(dst + i, v);
+	}
+#endif
+	for (; i < n; i++) {
+		dst[i] = value;
+	}
+}
+
+//ԪĹ֣OperationΪAddLanesSubLanesMulLanes֮һScalarOperationΪӦı
+#if VECTOR_WIDTH > 1
+#define ELEMENTWISE_LOOP(Operation)												\
+	for (; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH) {							\
+		Store(dst + i, Operation(Load(a + i), Load(b + i)));					\
+	}
+#else
+#define ELEMENTWISE_LOOP(Operation)
+#endif
+
+void VectorAdd(word_t* dst, const word_t* a, const word_t* b, uword_t n)
+{
+	uword_t i{};
+	ELEMENTWISE_LOOP(AddLanes)
+	for (; i < n; i++) {
+		dst[i] = (word_t)((uword_t)a[i] + (uword_t)b[i]);
+	}
+}
+
+void VectorSub(word_t* dst, const word_t* a, const word_t* b, uword_t n)
+{
+	uword_t i{};
+	ELEMENTWISE_LOOP(SubLanes)
+	for (; i < n; i++) {
+		dst[i] = (word_t)((uword_t)a[i] - (uword_t)b[i]);
+	}
+}
+
+void VectorMul(word_t* dst, const word_t* a, const word_t* b, uword_t n)
+{
+	uword_t i{};
+	ELEMENTWISE_LOOP(MulLanes)
+	for (; i < n; i++) {
+		dst[i] = (word_t)((uword_t)a[i] * (uword_t)b[i]);
+	}
+}
+
+word_t VectorSum(const word_t* a, uword_t n)
+{
+	uword_t i{};
+	uword_t sum{};
+#if VECTOR_WIDTH > 1
+	Vector vectorSum = Zero();
+	for (; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH) {
+		vectorSum = AddLanes(vectorSum, Load(a + i));
+	}
+	sum = HorizontalSum(vectorSum);
+#endif
+	for (; i < n; i++) {
+		sum += a[i];
+	}
+	return sum;
+}
+
+word_t VectorDot(const word_t* a, const word_t* b, uword_t n)
+{
+	uword_t i{};
+	uword_t sum{};
+#if VECTOR_WIDTH > 1
+	Vector vectorSum = Zero();
+	for (; i + VECTOR_WIDTH <= n; i += VECTOR_WIDTH) {
+		vectorSum = AddLanes(vectorSum, MulLanes(Load(a + i), Load(b + i)));
+	}
+	sum = HorizontalSum(vectorSum);
+#endif
+	for (; i < n; i++) {
+		sum += (uword_t)a[i] * (uword_t)b[i];
+	}
+	return sum;
+}
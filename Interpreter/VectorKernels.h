@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include "Instruction.h"
+
+/*
+VECָʵֱ֣ջڴ㣬nΪԪظ
+ʱAVX2g++ -mavx2ÿδ8Ԫأx86-64ʹSSEÿδ4Ԫأƽ̨64λģʽÿδԪظ
+ƣOPRָһ
+*/
+
+//dstsrcص
+void VectorCopy(word_t* dst, const word_t* src, uword_t n);
+void VectorFill(word_t* dst, word_t value, uword_t n);
+//dstabȫͬܲص
+void VectorAdd(word_t* dst, const word_t* a, const word_t* b, uword_t n);
+void VectorSub(word_t* dst, const word_t* a, const word_t* b, uword_t n);
+void VectorMul(word_t* dst, const word_t* a, const word_t* b, uword_t n);
+word_t VectorSum(const word_t* a, uword_t n);
+word_t VectorDot(const word_t* a, const word_t* b, uword_t n);
@@ -0,0 +1,245 @@
+#include "VirtualMemory.h"
+#include "OutputBuffer.h"
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#ifdef _WIN32
+#include <fstream>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <csignal>
+#include <csetjmp>
+#include <unistd.h>
+#endif
+
+//ڴĵַΧΥʱһǷ˱ҳ
+static constexpr size_t MaxRegions = 1024;
+static std::atomic<char*> RegionBegins[MaxRegions];
+static std::atomic<char*> RegionEnds[MaxRegions];
+static std::mutex RegionsMutex;			//ֻڱǼǺעźŴв
+
+#ifndef _WIN32
+//ǰ߳ڲRunGuardedתĿ꣬Ϊʱʱҳ
+static thread_local sigjmp_buf* GuardedJump;
+#endif
+
+static bool IsInRegion(const void* address)
+{
+	const char* p = (const char*)address;
+	for (size_t i{}; i < MaxRegions; i++) {
+		char* begin = RegionBegins[i].load(std::memory_order_acquire);
+		if (begin && p >= begin && p < RegionEnds[i].load(std::memory_order_relaxed)) return true;
+	}
+	return false;
+}
+
+static void ReportStackOverflow()
+{
+	static const char message[] = "Stack overflow\n";
+	COutputBuffer::FlushStandardOutputOnCrash();
+#ifdef _WIN32
+	DWORD written;
+	WriteFile(GetStdHandle(STD_ERROR_HANDLE), message, sizeof(message) - 1, &written, nullptr);
+	ExitProcess(1);
+#else
+	(void)!write(STDERR_FILENO, message, sizeof(message) - 1);
+	_exit(1);
+#endif
+}
+
+#ifdef _WIN32
+static LONG CALLBACK GuardPageHandler(EXCEPTION_POINTERS* exceptionInfo)
+{
+	const EXCEPTION_RECORD* record = exceptionInfo->ExceptionRecord;
+	if (record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION && IsInRegion((const void*)record->ExceptionInformation[1])) {
+		ReportStackOverflow();
+	}
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+#else
+static void GuardPageHandler(int signal, siginfo_t* info, void*)
+{
+	if (IsInRegion(info->si_addr)) {
+		if (GuardedJump) siglongjmp(*GuardedJump, 1);
+		ReportStackOverflow();
+	}
+
+	//ڴ棬ָĬϵĴʽغִгָ
+	struct sigaction action {};
+	action.sa_handler = SIG_DFL;
+	sigaction(signal, &action, nullptr);
+}
+#endif
+
+static void InstallGuardPageHandler()
+{
+	static bool installed = [] {
+#ifdef _WIN32
+		AddVectoredExceptionHandler(1, GuardPageHandler);
+#else
+		struct sigaction action {};
+		action.sa_sigaction = GuardPageHandler;
+		//ڼ䲻źţӴҪָź֣sigsetjmpҲͲҪҪһϵͳã
+		action.sa_flags = SA_SIGINFO | SA_NODEFER;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGSEGV, &action, nullptr);
+		sigaction(SIGBUS, &action, nullptr);
+#endif
+		return true;
+		}();
+	(void)installed;
+}
+
+CVirtualMemory::CVirtualMemory(size_t numUnits) : Size(numUnits * sizeof(word_t))
+{
+#ifdef _WIN32
+	//WindowsύʱͼύƣڴȻڵһηʱŷ
+	Data = (word_t*)VirtualAlloc(nullptr, Size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* data = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	Data = data == MAP_FAILED ? nullptr : (word_t*)data;
+#endif
+	if (!Data) return;
+
+	InstallGuardPageHandler();
+	std::lock_guard<std::mutex> lock(RegionsMutex);
+	for (size_t i{}; i < MaxRegions; i++) {
+		if (RegionBegins[i].load(std::memory_order_relaxed) == nullptr) {
+			RegionEnds[i].store((char*)Data + Size, std::memory_order_relaxed);
+			RegionBegins[i].store((char*)Data, std::memory_order_release);
+			break;
+		}
+	}
+}
+
+CVirtualMemory::~CVirtualMemory()
+{
+	if (!Data) return;
+	{
+		std::lock_guard<std::mutex> lock(RegionsMutex);
+		for (size_t i{}; i < MaxRegions; i++) {
+			if (RegionBegins[i].load(std::memory_order_relaxed) == (char*)Data) RegionBegins[i].store(nullptr, std::memory_order_release);
+		}
+	}
+#ifdef _WIN32
+	VirtualFree(Data, 0, MEM_RELEASE);
+#else
+	munmap(Data, Size);
+#endif
+}
+
+word_t* CVirtualMemory::GetData() const
+{
+	return Data;
+}
+
+void CVirtualMemory::AddGuardPage(uword_t address)
+{
+	GuardPages.push_back(address);
+#ifdef _WIN32
+	DWORD oldProtect;
+	VirtualProtect(Data + address, PageUnits * sizeof(word_t), PAGE_NOACCESS, &oldProtect);
+#else
+	mprotect(Data + address, PageUnits * sizeof(word_t), PROT_NONE);
+#endif
+}
+
+void CVirtualMemory::Clear()
+{
+	//ͷһΣֱһҳϻõֱ֮²ȱҳжϿ
+	constexpr size_t KeepBytes = 64 * 1024;
+	size_t keep = std::min(KeepBytes, Size);
+	for (uword_t address : GuardPages) {
+		keep = std::min(keep, (size_t)address * sizeof(word_t));
+	}
+#ifndef _WIN32
+	if (bFileMapped) {
+		//ӳļҳٴηʵõļݣӳΪڴ棬ñҳ
+		mmap(Data, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+		for (uword_t address : GuardPages) {
+			mprotect(Data + address, PageUnits * sizeof(word_t), PROT_NONE);
+		}
+		bFileMapped = false;
+		return;
+	}
+#endif
+	std::memset(Data, 0, keep);
+	keep = (keep + PageUnits * sizeof(word_t) - 1) / (PageUnits * sizeof(word_t)) * (PageUnits * sizeof(word_t));
+	if (keep >= Size) return;
+
+	char* rest = (char*)Data + keep;
+#ifdef _WIN32
+	//ύҳΪ0ҲָΪɶд
+	VirtualFree(rest, Size - keep, MEM_DECOMMIT);
+	VirtualAlloc(rest, Size - keep, MEM_COMMIT, PAGE_READWRITE);
+	for (uword_t address : GuardPages) {
+		DWORD oldProtect;
+		VirtualProtect(Data + address, PageUnits * sizeof(word_t), PAGE_NOACCESS, &oldProtect);
+	}
+#else
+	//˽ӳҳٴηʱõȫ0ҳҳԲ
+	madvise(rest, Size - keep, MADV_DONTNEED);
+#endif
+}
+
+bool CVirtualMemory::MapFile(const std::string& fileName, uint64_t offset, uword_t address, uword_t numUnits)
+{
+	size_t size = (size_t)numUnits * sizeof(word_t);
+	if (size == 0) return true;
+#ifndef _WIN32
+	int file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0) return false;
+	//ҳĴСPageUnitsһʱַһ뵽ҳֻܶȡ
+	if (sysconf(_SC_PAGESIZE) == PageUnits * sizeof(word_t)) {
+		void* mapped = mmap(Data + address, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file, (off_t)offset);
+		close(file);
+		if (mapped == MAP_FAILED) return false;
+		bFileMapped = true;
+		return true;
+	}
+	char* p = (char*)(Data + address);
+	while (size > 0) {
+		ssize_t count = pread(file, p, size, (off_t)offset);
+		if (count <= 0) break;
+		p += count;
+		offset += count;
+		size -= count;
+	}
+	close(file);
+	return size == 0;
+#else
+	std::ifstream file(fileName, std::ios::binary);
+	file.seekg(offset);
+	file.read((char*)(Data + address), size);
+	return (bool)file;
+#endif
+}
+
+bool CVirtualMemory::RunGuarded(const std::function<void()>& function)
+{
+#ifdef _WIN32
+	function();
+	return true;
+#else
+	sigjmp_buf jump;
+	sigjmp_buf* previous = GuardedJump;
+	if (sigsetjmp(jump, 0)) {
+		GuardedJump = previous;
+		return false;
+	}
+	GuardedJump = &jump;
+	try {
+		function();
+	}
+	catch (...) {
+		GuardedJump = previous;
+		throw;
+	}
+	GuardedJump = previous;
+	return true;
+#endif
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Instruction.h"
+
+/*
+ڴ棺Ԥȱһεַռ䣬ĳһҳһαʱϵͳΪڴ棨Ϊ0
+԰еĳЩҳΪҳRunGuardedзʱҳʱfalseʱ"Stack overflow"
+*/
+class CVirtualMemory
+{
+private:
+	word_t* Data{};
+	size_t Size{};							//λΪֽ
+	std::vector<uword_t> GuardPages;
+	bool bFileMapped{};						//еҳӳļClearʱֻЩҳ
+
+public:
+	static constexpr uword_t PageUnits = 4096 / sizeof(word_t);	//һҳ4KBĵԪҳĵַ
+
+	//numUnitsԪĵַռ䣬ʧʱGetData()ؿָ
+	explicit CVirtualMemory(size_t numUnits);
+	~CVirtualMemory();
+	CVirtualMemory(const CVirtualMemory&) = delete;
+	CVirtualMemory& operator=(const CVirtualMemory&) = delete;
+
+	word_t* GetData() const;
+	//addressʼһҳΪҳ
+	void AddGuardPage(uword_t address);
+	//ȫ㣬ҳ䣺ͷһСֱmemsetҳϵͳٴηʱ·
+	void Clear();
+	/*
+	ļдoffsetʼдʱƵķʽӳ䵽addressʼnumUnitsԪaddressoffsetҳ
+	дЩԪıļӳڼļܱ޸Ļض̣ClearָΪȫ0ڴ档ӳʱΪȡļ
+	*/
+	bool MapFile(const std::string& fileName, uint64_t offset, uword_t address, uword_t numUnits);
+
+	/*
+	ڵǰִ߳functionڼκڴıҳʱٽ򣬶ǷfunctionлûִеĲֲfalse
+	ʱfunctionоֲҲͷѾõִָֻǶ
+	Windowsϲִ֧쳣Ȼ
+	*/
+	static bool RunGuarded(const std::function<void()>& function);
+};
@@ -0,0 +1,115 @@
+#include "WorkStealingPool.h"
+
+CWorkStealingPool::CWorkStealingPool(uint32_t numWorkers)
+{
+	if (numWorkers == 0) numWorkers = 1;
+	for (uint32_t i{}; i < numWorkers; i++) {
+		Queues.push_back(std::make_unique<SWorkerQueue>());
+	}
+	for (uint32_t i = 1; i < numWorkers; i++) {
+		Threads.emplace_back(&CWorkStealingPool::WorkerLoop, this, i);
+	}
+}
+
+CWorkStealingPool::~CWorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		bStopping = true;
+	}
+	JobStarted.notify_all();
+	for (auto& thread : Threads) {
+		thread.join();
+	}
+}
+
+uint32_t CWorkStealingPool::GetNumWorkers() const
+{
+	return Queues.size();
+}
+
+bool CWorkStealingPool::TakeTask(uint32_t workerIndex, uint32_t& taskIndex)
+{
+	{
+		SWorkerQueue& queue = *Queues[workerIndex];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if (!queue.Tasks.empty()) {
+			taskIndex = queue.Tasks.back();
+			queue.Tasks.pop_back();
+			return true;
+		}
+	}
+	for (uint32_t k = 1; k < Queues.size(); k++) {
+		SWorkerQueue& victim = *Queues[(workerIndex + k) % Queues.size()];
+		std::lock_guard<std::mutex> lock(victim.Mutex);
+		if (!victim.Tasks.empty()) {
+			taskIndex = victim.Tasks.front();
+			victim.Tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void CWorkStealingPool::ProcessTasks(uint32_t workerIndex, const std::function<void(uint32_t, uint32_t)>& task)
+{
+	//ֻRunʼʱУжжԺ󲻻µ
+	uint32_t taskIndex;
+	while (TakeTask(workerIndex, taskIndex)) {
+		task(taskIndex, workerIndex);
+	}
+}
+
+void CWorkStealingPool::WorkerLoop(uint32_t workerIndex)
+{
+	uint64_t lastJobId{};
+	while (true) {
+		const std::function<void(uint32_t, uint32_t)>* task;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			JobStarted.wait(lock, [&] { return bStopping || JobId != lastJobId; });
+			if (bStopping) return;
+			lastJobId = JobId;
+			task = Task;
+		}
+
+		ProcessTasks(workerIndex, *task);
+
+		{
+			std::lock_guard<std::mutex> lock(Mutex);
+			NumBusyThreads--;
+		}
+		JobFinished.notify_all();
+	}
+}
+
+void CWorkStealingPool::Run(uint32_t numTasks, const std::function<void(uint32_t, uint32_t)>& task)
+{
+	//˳ƽֳɶΣʹڵͬһִ߳
+	uint32_t numWorkers = Queues.size();
+	for (uint32_t i{}; i < numWorkers; i++) {
+		SWorkerQueue& queue = *Queues[i];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		uint32_t begin = (uint64_t)numTasks * i / numWorkers;
+		uint32_t end = (uint64_t)numTasks * (i + 1) / numWorkers;
+		//̴߳Ӷβȡ˵
+		for (uint32_t taskIndex = end; taskIndex > begin; taskIndex--) {
+			queue.Tasks.push_back(taskIndex - 1);
+		}
+	}
+
+	//ÿҪ̶߳벢˳ŷأ߳Runغʹtask
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Task = &task;
+		NumBusyThreads = Threads.size();
+		JobId++;
+	}
+	JobStarted.notify_all();
+
+	ProcessTasks(0, task);
+
+	std::unique_lock<std::mutex> lock(Mutex);
+	JobFinished.wait(lock, [&] { return NumBusyThreads == 0; });
+	Task = nullptr;
+}
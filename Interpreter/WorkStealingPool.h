@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+//ȡ̳߳أԤƽ䵽̵߳ĶУ߳Լ̵߳Ķȡ
+class CWorkStealingPool
+{
+private:
+	//ÿ̵߳У߳ԼӶβȡ̴߳Ӷͷȡ
+	struct SWorkerQueue {
+		std::mutex Mutex;
+		std::deque<uint32_t> Tasks;
+	};
+	std::vector<std::unique_ptr<SWorkerQueue>> Queues;
+	std::vector<std::thread> Threads;		//0߳ǵRuṇ߳
+
+	std::mutex Mutex;
+	std::condition_variable JobStarted;
+	std::condition_variable JobFinished;
+	const std::function<void(uint32_t, uint32_t)>* Task{};
+	uint64_t JobId{};
+	uint32_t NumBusyThreads{};				//û굱ǰ߳
+	bool bStopping{};
+
+	//ȡһȡԼģȡ̵߳ģжж򷵻false
+	bool TakeTask(uint32_t workerIndex, uint32_t& taskIndex);
+	void ProcessTasks(uint32_t workerIndex, const std::function<void(uint32_t, uint32_t)>& task);
+	void WorkerLoop(uint32_t workerIndex);
+
+public:
+	//numWorkersRun߳
+	explicit CWorkStealingPool(uint32_t numWorkers);
+	~CWorkStealingPool();
+
+	uint32_t GetNumWorkers() const;
+	//ִtask(taskIndex, workerIndex)taskIndexȡ[0, numTasks)workerIndexΪִи̵߳ıţΪ0ִ̲߳Уȫɺ󷵻
+	void Run(uint32_t numTasks, const std::function<void(uint32_t, uint32_t)>& task);
+};
@@ -0,0 +1,241 @@
+﻿#include <iostream>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <map>
+#include <vector>
+#include "LexicalAnalyzer.h"
+#include "CodeGenerator.h"
+#include "CompileCache.h"
+#include "Utils.h"
+#include "Pl0VirtualMachine.h"
+
+void ShowUsage()
+{
+	std::cout << "Usage: \n\n";
+	std::cout << "pl0 run [--list] [--no-cache] [--cache-dir DIR] [--threads N] [--seed N] [--max-stack MB] [--heap-stats] [--line-buffered] [--binary-output] [--input FILE] [--binary-input] [--profile FILE] [--profile-folded FILE] <SourceFilePath>\n\n";
+	std::cout << "Compile the source file in memory and run it, without writing an executable file.\n";
+	std::cout << "--list         print the generated instructions before running\n";
+	std::cout << "--no-cache     always compile, without using the compile cache shared with Compiler\n";
+	std::cout << "--cache-dir DIR directory of the compile cache, default is $PL0_CACHE_DIR or the user's cache directory\n";
+	std::cout << "--profile FILE write instructions and time per procedure and per source line to FILE\n";
+	std::cout << "--profile-folded FILE write folded call stacks weighted by microseconds to FILE, for flamegraph.pl\n";
+	std::cout << "The other options are the same as those of Interpreter.\n";
+	exit(0);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3 || std::string(argv[1]) != "run") ShowUsage();
+
+	//从命令行参数中获取选项和源文件路径
+	bool printInstructions{};
+	bool useCache = true;
+	std::filesystem::path cacheDirectory = CCompileCache::GetDefaultDirectory();
+	uint32_t numThreads{};
+	bool printHeapStats{};
+	bool hasSeed{};
+	uint64_t seed{};
+	bool lineBuffered{};
+	EOutputFormat outputFormat = EOutputFormat::Text;
+	std::string inputFile;
+	EInputFormat inputFormat = EInputFormat::Text;
+	std::string profileFile;
+	std::string foldedProfileFile;
+	uword_t maxStackSize = Pl0VirtualMachine::DefaultMaxStackSize;
+	int argIndex = 2;
+	while (argIndex < argc - 1) {
+		std::string option = argv[argIndex];
+		if (option == "--list") {
+			printInstructions = true;
+			argIndex++;
+		}
+		else if (option == "--no-cache") {
+			useCache = false;
+			argIndex++;
+		}
+		else if (option == "--cache-dir") {
+			cacheDirectory = argv[argIndex + 1];
+			if (cacheDirectory.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--threads") {
+			int value = std::atoi(argv[argIndex + 1]);
+			if (value <= 0) ShowUsage();
+			numThreads = value;
+			argIndex += 2;
+		}
+		else if (option == "--seed") {
+			char* end;
+			seed = std::strtoull(argv[argIndex + 1], &end, 10);
+			if (*end != '\0' || end == argv[argIndex + 1]) ShowUsage();
+			hasSeed = true;
+			argIndex += 2;
+		}
+		else if (option == "--max-stack") {
+			constexpr long long MaxStackMB = std::min<long long>(std::numeric_limits<uword_t>::max() / (1024 * 1024 / sizeof(word_t)), 1LL << 30);
+			long long value = std::atoll(argv[argIndex + 1]);
+			if (value <= 0 || value > MaxStackMB) ShowUsage();
+			maxStackSize = (uword_t)value * (1024 * 1024 / sizeof(word_t));
+			argIndex += 2;
+		}
+		else if (option == "--heap-stats") {
+			printHeapStats = true;
+			argIndex++;
+		}
+		else if (option == "--line-buffered") {
+			lineBuffered = true;
+			argIndex++;
+		}
+		else if (option == "--binary-output") {
+			outputFormat = EOutputFormat::Binary;
+			argIndex++;
+		}
+		else if (option == "--input") {
+			inputFile = argv[argIndex + 1];
+			if (inputFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--binary-input") {
+			inputFormat = EInputFormat::Binary;
+			argIndex++;
+		}
+		else if (option == "--profile") {
+			profileFile = argv[argIndex + 1];
+			if (profileFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else if (option == "--profile-folded") {
+			foldedProfileFile = argv[argIndex + 1];
+			if (foldedProfileFile.empty()) ShowUsage();
+			argIndex += 2;
+		}
+		else break;
+	}
+	if (argc - argIndex != 1)
+		ShowUsage();
+	std::string sourceFilePath = argv[argIndex];
+
+	//导入的模块在源文件所在的目录中查找
+	std::vector<std::filesystem::path> moduleSearchPath{ std::filesystem::path(sourceFilePath).parent_path() };
+	if (moduleSearchPath[0].empty()) moduleSearchPath[0] = ".";
+	std::string source;
+	bool isModule{};
+	std::vector<std::string> imports;
+	std::ifstream sourceFile{ sourceFilePath,std::ios::binary };
+	if (sourceFile.is_open()) {
+		source.assign(std::istreambuf_iterator<char>(sourceFile), std::istreambuf_iterator<char>());
+		ScanModuleHeader(source, isModule, imports);
+	}
+	if (isModule) {
+		std::cerr << "Error: " << sourceFilePath << " is a module, a module cannot be run" << std::endl;
+		return 1;
+	}
+
+	//与Compiler共用编译结果的缓存，命中时不需要编译；要输出指令或者需要符号表进行性能分析时总是重新编译
+	//导入的模块也是缓存的键的一部分，读取模块出错时不使用缓存，由编译报告错误
+	bool profiling = !profileFile.empty() || !foldedProfileFile.empty();
+	std::shared_ptr<const SProgram> program;
+	std::shared_ptr<const SSymbolTable> symbols;
+	std::unique_ptr<CCompileCache> cache;
+	std::string cacheKey;
+	std::map<std::string, std::shared_ptr<const SObjectFile>> modules;
+	if (useCache && !cacheDirectory.empty() && sourceFile.is_open()) {
+		std::vector<std::pair<std::string, std::string>> moduleContents;
+		for (auto& moduleName : imports) {
+			std::string content, errorMessage;
+			auto object = LoadModule(moduleName, moduleSearchPath, content, errorMessage);
+			if (!object) break;
+			modules[moduleName] = object;
+			moduleContents.emplace_back(moduleName, std::move(content));
+		}
+		if (modules.size() == imports.size()) {
+			cache = std::make_unique<CCompileCache>(cacheDirectory);
+			cacheKey = CCompileCache::MakeKey(source, moduleContents);
+			std::string executable, errorMessage;
+			if (!printInstructions && !profiling && cache->Lookup(cacheKey, executable)) {
+				program = Pl0VirtualMachine::ReadProgram(executable.data(), executable.size(), errorMessage);
+			}
+		}
+	}
+
+	if (!program) {
+		//编译，出错时输出错误信息并结束
+		try {
+			CLexicalAnalyzer LexicalAnalyzer{ sourceFilePath };
+			LexicalAnalyzer.LexicalAnalyze();
+			CCodeGenerator CodeGenerator{ LexicalAnalyzer.GetTerminatorSequence() };
+			CodeGenerator.SetSourceFile(sourceFilePath);
+			CodeGenerator.SetModuleSearchPath(moduleSearchPath);
+			for (auto& [moduleName, object] : modules) {
+				CodeGenerator.SetModule(moduleName, object);
+			}
+			CodeGenerator.GenerateCode();
+			if (printInstructions) CodeGenerator.PrintInstructions();
+			if (cache) {
+				std::ostringstream executable;
+				CodeGenerator.Output(executable);
+				cache->Store(cacheKey, executable.str());
+			}
+			//生成的指令序列和数据段直接交给虚拟机，不经过可执行文件
+			std::string errorMessage;
+			program = Pl0VirtualMachine::CreateProgram(CodeGenerator.GetInstructions(), CCodeGenerator::DataAddress, CodeGenerator.GetData(), errorMessage);
+			if (!program) {
+				std::cerr << "Error: " << errorMessage << std::endl;
+				return 1;
+			}
+			if (profiling) symbols = std::make_shared<SSymbolTable>(CodeGenerator.GetSymbols());
+		}
+		catch (const CCompileError& error) {
+			std::cerr << "Error: " << error.what() << std::endl;
+			return 1;
+		}
+	}
+
+	auto output = std::make_shared<COutputBuffer>();
+	output->SetFormat(outputFormat);
+	if (lineBuffered) output->SetLineBuffered(true);
+	std::shared_ptr<CInputReader> input;
+	if (inputFile.empty()) input = std::make_shared<CInputReader>(inputFormat);
+	else input = std::make_shared<CInputReader>(inputFile, inputFormat);
+	if (!input->IsOpen()) {
+		std::cerr << "Cannot open input file: " << inputFile << std::endl;
+		return 1;
+	}
+
+	Pl0VirtualMachine vm{ maxStackSize };
+	vm.SetOutput(output);
+	vm.SetInput(input);
+	if (numThreads) vm.SetNumThreads(numThreads);
+	if (!vm.Load(std::move(program))) {
+		std::cerr << vm.GetErrorMessage() << std::endl;
+		return 1;
+	}
+	if (hasSeed) vm.SetSeed(seed);
+	if (profiling) vm.EnableProfiling(symbols);
+
+	ERunStatus status = vm.Run();
+	//程序出错时也输出已经执行的部分的分析结果
+	if (profiling) {
+		std::string errorMessage;
+		if (!vm.GetProfiler()->WriteFiles(profileFile, foldedProfileFile, errorMessage)) {
+			std::cerr << errorMessage << std::endl;
+			return 1;
+		}
+	}
+	if (status != ERunStatus::Finished) {
+		std::cerr << vm.GetErrorMessage() << std::endl;
+		return 1;
+	}
+	if (outputFormat == EOutputFormat::Text) {
+		static const char message[] = "========= Program finished =========\n";
+		output->Write(message, sizeof(message) - 1);
+	}
+	output->Flush();
+	if (printHeapStats) vm.PrintHeapStats(std::cerr);
+	return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include "Instruction.h"
+
+/*
+ִļĸʽļͷ֮NumInstructionsָ֮DataSizeɵݶ
+ݶջ֡дDataAddressʼıͳĳʼֵʱֱӶջУҪִκָ
+*/
+struct SExecutableHeader
+{
+	uint32_t Magic;
+	uint32_t WordSize;					//sizeof(word_t)ֳһ
+	uint64_t NumInstructions;
+	uint64_t DataAddress;
+	uint64_t DataSize;
+};
+
+constexpr uint32_t ExecutableMagic = 0x58304C50;	//"PL0X"
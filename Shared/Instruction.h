@@ -1,11 +1,25 @@
 #pragma once
 #include <cstdint>
 
+/*
+֣ջݶΡѵÿԪԼָaһ
+ĬΪ32λͽ-DPL0_64BITʱΪ64λ㰴64λƣַռҲ֮
+ģʽɵĿִļͨãļͷм¼ֳʱ
+*/
+#ifdef PL0_64BIT
+typedef int64_t word_t;
+typedef uint64_t uword_t;
+#else
+typedef int32_t word_t;
+typedef uint32_t uword_t;
+#endif
+constexpr int WordBits = sizeof(word_t) * 8;
+
 struct Instruction
 {
 	uint16_t F;
 	int16_t L;
-	int32_t a;
+	word_t a;
 };
 
 //FеĲ
@@ -27,6 +41,19 @@ constexpr uint16_t RAN_N = 14;
 constexpr uint16_t RAN = 15;
 constexpr uint16_t STR_v2 = 16;	//STRֻͬὫջԪصջ
 constexpr uint16_t POP = 17;
+constexpr uint16_t CAL_v2 = 18;	//CALͬǲѹSLڲҪ̬ӳջ֡ͷֻDLRA
+constexpr uint16_t LDG = 19;		//ȫֱıֵaΪԵַ
+constexpr uint16_t STO_v2 = 20;	//STOͬǲջԪصջ
+constexpr uint16_t FOR = 21;		//forѭջΪֵֵһִʱѳֵǰջ֡ƫΪLѭ֮ÿμϲδԽֵתa򵯳ֵ
+constexpr uint16_t JTB = 22;		//תջ±꣬a+1JMPָ±[0, a)ʱִе±JMPתִһJMPת
+constexpr uint16_t VEC = 23;		//㣺LΪVEC룬aΪԪظջΪ׵ַvfillҪֵ
+constexpr uint16_t FAL = 24;		//forallѭջΪֵջΪֵеÿֵеصõַΪaѭ壬ѭջ֡ͷΪDLRASL֮ѭ
+constexpr uint16_t HLT = 25;		//ڲʹãָĩβforallѭ巵صʱôε
+constexpr uint16_t NEW = 26;		//ڶϷջԪջѹõĵַ
+constexpr uint16_t FRE = 27;		//ͷջĵַָġNEWڴ棬ջ
+constexpr uint16_t RED = 28;		//жȡһѹջ
+constexpr uint16_t RDA = 29;		//ȡ飺aΪĴСn׵ַȡn飬ѹʵʶĸ
+constexpr uint16_t SNP = 30;		//գָ˿ļʱ״̬дУ֮һָʲôҲ
 
 
 //OPRָaеĲ
@@ -42,3 +69,23 @@ constexpr int32_t NotEqual = 8;
 constexpr int32_t GreaterEqual = 9;
 constexpr int32_t GreaterThan = 10;
 constexpr int32_t Odd = 11;
+constexpr int32_t Mod = 12;			//ȡ࣬ķ뱻ͬ
+constexpr int32_t Shl = 13;			//ƣλλֳȡģ
+constexpr int32_t Shr = 14;			//ƣλλֳȡģ
+constexpr int32_t And = 15;
+constexpr int32_t Or = 16;
+constexpr int32_t Xor = 17;
+constexpr int32_t Min = 18;
+constexpr int32_t Max = 19;
+constexpr int32_t Abs = 20;
+constexpr int32_t DivPow2 = 21;		//2ջݣ0ȡɳ2ݵĳŻõ
+
+
+//VECָLе
+constexpr int16_t VecCopy = 0;		//vcopy(dst, src)srcdst
+constexpr int16_t VecFill = 1;		//vfill(dst, v)vdst
+constexpr int16_t VecAdd = 2;		//vadd(dst, a, b)badstdst[i] = a[i] + b[i]
+constexpr int16_t VecSub = 3;		//vsub(dst, a, b)
+constexpr int16_t VecMul = 4;		//vmul(dst, a, b)
+constexpr int16_t VecSum = 5;		//vsum(a)aѹԪ֮
+constexpr int16_t VecDot = 6;		//vdot(a, b)baѹ
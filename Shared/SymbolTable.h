@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//кűһӳдOffsetʼֱһ֮ǰָԴļĵLine
+struct SLineEntry
+{
+	uint32_t Offset;
+	uint32_t Line;
+};
+
+//űеһӳ
+struct SSymbolProcedure
+{
+	uint32_t Address;						//ڵַCALָĿ
+	std::string Name;						//֣"p1::p2""lib::inc"Ϊ"main"
+};
+
+//űеһУAddressʼֱһ֮ǰָFiles[File]ĵLine
+struct SSymbolLine
+{
+	uint32_t Address;
+	uint32_t File;
+	uint32_t Line;
+};
+
+/*
+ִļķűɱ--symbolsдִļԱߵ"ִļ.sym"ܷʹ
+ļıʽһΪ"pl0-symbols ֳ ָ"ָͬʱ˵űִļ֮ÿΪ֮һ
+file ·					Ϊ01Դļ
+procedure ַ 
+line ַ Դļ± к
+*/
+struct SSymbolTable
+{
+	uint64_t NumInstructions{};
+	std::vector<std::string> Files;			//͸ģԴļ
+	std::vector<SSymbolProcedure> Procedures;	//ַС
+	std::vector<SSymbolLine> Lines;			//ַС
+};